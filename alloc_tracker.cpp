@@ -0,0 +1,163 @@
+#include "alloc_tracker.h"
+
+#include <atomic>     // for std::atomic
+#include <cstdio>     // for std::snprintf
+#include <cstdlib>    // for std::malloc, std::free, std::size_t
+#include <new>        // for std::bad_alloc, std::nothrow_t
+
+
+namespace {
+
+// The counts are shared by all the threads (the BatchSolver and the server allocate from several threads),
+// and only ever added to, so relaxed atomics are enough.
+struct PhaseCounters {
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> deallocations{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+PhaseCounters counters[NUM_ALLOC_PHASES];
+
+thread_local AllocPhase current_phase = PHASE_SETUP;
+
+const char* const PHASE_NAMES[NUM_ALLOC_PHASES] = {"setup", "solve", "render"};
+
+}  // namespace
+
+
+bool alloc_tracking_enabled()
+{
+#ifdef HANOI_TRACK_ALLOCS
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+AllocPhase set_alloc_phase(AllocPhase phase)
+{
+    AllocPhase previous = current_phase;
+    current_phase = phase;
+    return previous;
+}
+
+
+AllocStats alloc_stats(AllocPhase phase)
+{
+    return AllocStats{counters[phase].allocations.load(std::memory_order_relaxed),
+		      counters[phase].deallocations.load(std::memory_order_relaxed),
+		      counters[phase].bytes.load(std::memory_order_relaxed)};
+}
+
+
+void reset_alloc_stats()
+{
+    for (PhaseCounters& phase : counters) {
+	phase.allocations.store(0, std::memory_order_relaxed);
+	phase.deallocations.store(0, std::memory_order_relaxed);
+	phase.bytes.store(0, std::memory_order_relaxed);
+    }
+}
+
+
+string alloc_report(uint64_t moves)
+{
+    string report;
+    char line[160];
+    for (int phase = 0; phase < NUM_ALLOC_PHASES; ++phase) {
+	AllocStats stats = alloc_stats(AllocPhase(phase));
+	std::snprintf(line, sizeof(line), "%-6s allocations %llu deallocations %llu bytes %llu per_move %.6f\n",
+		      PHASE_NAMES[phase], (unsigned long long)stats.allocations, (unsigned long long)stats.deallocations,
+		      (unsigned long long)stats.bytes, moves == 0 ? 0.0 : double(stats.allocations) / moves);
+	report += line;
+    }
+    return report;
+}
+
+
+#ifdef HANOI_TRACK_ALLOCS
+
+/*
+ * The replacements of the global operator new and operator delete.
+ * The other forms (nothrow, sized delete) are replaced too, so that every allocation and deallocation is seen.
+ * The aligned forms (std::align_val_t) are left to the standard library, nothing in the program uses them.
+ */
+
+namespace {
+
+void* tracked_malloc(std::size_t size)
+{
+    PhaseCounters& phase = counters[current_phase];
+    phase.allocations.fetch_add(1, std::memory_order_relaxed);
+    phase.bytes.fetch_add(size, std::memory_order_relaxed);
+    // malloc(0) may return nullptr, but operator new must return a unique pointer.
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void tracked_free(void* pointer)
+{
+    if (pointer != nullptr) {
+	counters[current_phase].deallocations.fetch_add(1, std::memory_order_relaxed);
+	std::free(pointer);
+    }
+}
+
+}  // namespace
+
+
+void* operator new(std::size_t size)
+{
+    void* pointer = tracked_malloc(size);
+    if (pointer == nullptr) {
+	throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return tracked_malloc(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return tracked_malloc(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    tracked_free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    tracked_free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+    tracked_free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept
+{
+    tracked_free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept
+{
+    tracked_free(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept
+{
+    tracked_free(pointer);
+}
+
+#endif /* HANOI_TRACK_ALLOCS */
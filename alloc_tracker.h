@@ -0,0 +1,91 @@
+#ifndef ALLOC_TRACKER_H
+#define ALLOC_TRACKER_H
+
+#include <cstdint>   // for std::uint64_t
+#include <string>    // for std::string
+
+using std::string;
+using std::uint64_t;
+
+/*
+ * Allocation tracking, for finding out what allocates memory and when.
+ *
+ * When the program is built with -DHANOI_TRACK_ALLOCS (make check-allocs), alloc_tracker.cpp replaces
+ * the global operator new and operator delete, and every allocation is counted against the phase
+ * the calling thread is in:
+ *   setup  - building the game and the Drawer, before the first move.
+ *   solve  - computing and making the moves.
+ *   render - drawing the moves.
+ * ALLOC_PHASE(phase) puts the calling thread in that phase until the end of the enclosing block.
+ * Otherwise ALLOC_PHASE(phase) is nothing at all, and the normal build pays nothing.
+ */
+
+enum AllocPhase {
+    PHASE_SETUP,
+    PHASE_SOLVE,
+    PHASE_RENDER,
+    NUM_ALLOC_PHASES
+};
+
+// The counts of one phase.
+struct AllocStats {
+    // The number of calls to operator new and operator new[].
+    uint64_t allocations;
+    // The number of calls to operator delete and operator delete[] with a pointer which is not nullptr.
+    uint64_t deallocations;
+    // The number of bytes asked for by the allocations.
+    uint64_t bytes;
+};
+
+/**
+ * @return bool - true if the program was built with -DHANOI_TRACK_ALLOCS, so the counts mean something.
+ */
+bool alloc_tracking_enabled();
+
+/**
+ * Puts the calling thread in a phase.
+ *
+ * @param AllocPhase phase - The new phase.
+ * @return AllocPhase - The phase the thread was in before. Threads start in PHASE_SETUP.
+ */
+AllocPhase set_alloc_phase(AllocPhase phase);
+
+/**
+ * @return AllocStats - The counts of a phase, from all the threads, since the start or since reset_alloc_stats().
+ */
+AllocStats alloc_stats(AllocPhase phase);
+
+/**
+ * Zeroes the counts of all the phases.
+ */
+void reset_alloc_stats();
+
+/**
+ * Writes the counts of every phase, one phase per line:
+ * the name of the phase, the allocations, the deallocations, the bytes, and the allocations per move.
+ *
+ * @param uint64_t moves - The number of moves made in the run, > 0 to get the allocations per move.
+ * @return string - The report.
+ */
+string alloc_report(uint64_t moves);
+
+// Puts the calling thread back in the phase it was in when it is destroyed.
+class AllocPhaseScope {
+  public:
+    explicit AllocPhaseScope(AllocPhase phase) : previous{set_alloc_phase(phase)} {}
+    ~AllocPhaseScope() { set_alloc_phase(previous); }
+
+    AllocPhaseScope(const AllocPhaseScope& other) = delete;
+    AllocPhaseScope& operator=(const AllocPhaseScope& other) = delete;
+
+  private:
+    AllocPhase previous;
+};
+
+#ifdef HANOI_TRACK_ALLOCS
+#define ALLOC_PHASE(phase) AllocPhaseScope alloc_phase_scope_##phase(phase)
+#else
+#define ALLOC_PHASE(phase)
+#endif
+
+#endif /* ALLOC_TRACKER_H */
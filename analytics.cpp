@@ -0,0 +1,155 @@
+#include "analytics.h"
+
+#include <algorithm>  // for std::sort, std::unique, std::lower_bound
+#include <stdexcept>  // for std::invalid_argument
+
+
+namespace {
+
+void check_game(size_t num_disks, int source, int target)
+{
+    if (num_disks == 0 || num_disks > MAX_ANALYTICS_DISKS) {
+	throw std::invalid_argument("the number of disks must be 1 ... " + std::to_string(MAX_ANALYTICS_DISKS));
+    }
+    if (source < 0 || source > 2 || target < 0 || target > 2 || source == target) {
+	throw std::invalid_argument("invalid towers");
+    }
+}
+
+void check_range(size_t num_disks, uint64_t first, uint64_t end)
+{
+    if (first > end || end > (uint64_t(1) << num_disks) - 1) {
+	throw std::invalid_argument("invalid range");
+    }
+}
+
+/**
+ * The statistics of the first k moves, [0, k).
+ */
+RangeStats prefix_stats(size_t num_disks, uint64_t k, int source, int target)
+{
+    RangeStats stats{};
+    stats.num_disks = num_disks;
+    stats.end = k;
+
+    // The largest disk steps once from source to target, and every next smaller disk steps the other way around.
+    int largest_step = (target - source + 3) % 3;
+    for (size_t disk = 0; disk < num_disks; ++disk) {
+	int step = (num_disks - 1 - disk) % 2 == 0 ? largest_step : 3 - largest_step;
+	// The number of moves of this disk among the first k moves.
+	uint64_t moves = ((k >> disk) + 1) >> 1;
+	stats.moves_per_disk[disk] = moves;
+
+	// After j of its moves the disk is on the tower source + j * step, so only j modulo 3 matters.
+	// Between its moves number j - 1 and j it stays put for 2^(disk + 1) moves, and before its first move for 2^disk.
+	// The move k itself falls into the stay after its move number moves - 1.
+	uint64_t stay_start = moves == 0 ? 0 : ((2 * moves - 1) << disk);
+	for (uint64_t r = 0; r < 3; ++r) {
+	    int from = (source + r * step) % 3;
+	    int to   = (from + step) % 3;
+	    // The number of j in [0, moves) with j % 3 == r.
+	    uint64_t count = (moves + 2 - r) / 3;
+	    stats.traffic[from][to] += count;
+
+	    uint64_t time = (count << (disk + 1)) - (r == 0 && count > 0 ? uint64_t(1) << disk : 0);
+	    if (moves % 3 == r) {
+		time += k - stay_start;
+	    }
+	    stats.time_on_tower[disk][from] += time;
+	}
+    }
+    return stats;
+}
+
+/**
+ * @return RangeStats - The statistics of [a.end, b.end), for two prefixes with a.end <= b.end.
+ */
+RangeStats difference(const RangeStats& b, const RangeStats& a)
+{
+    RangeStats stats{};
+    stats.num_disks = b.num_disks;
+    stats.first = a.end;
+    stats.end   = b.end;
+    for (size_t disk = 0; disk < b.num_disks; ++disk) {
+	stats.moves_per_disk[disk] = b.moves_per_disk[disk] - a.moves_per_disk[disk];
+	for (int tower = 0; tower < 3; ++tower) {
+	    stats.time_on_tower[disk][tower] = b.time_on_tower[disk][tower] - a.time_on_tower[disk][tower];
+	}
+    }
+    for (int from = 0; from < 3; ++from) {
+	for (int to = 0; to < 3; ++to) {
+	    stats.traffic[from][to] = b.traffic[from][to] - a.traffic[from][to];
+	}
+    }
+    return stats;
+}
+
+}  // namespace
+
+
+RangeStats range_stats(size_t num_disks, uint64_t first, uint64_t end, int source, int target)
+{
+    check_game(num_disks, source, target);
+    check_range(num_disks, first, end);
+    return difference(prefix_stats(num_disks, end, source, target), prefix_stats(num_disks, first, source, target));
+}
+
+
+vector<RangeStats> range_stats_batch(size_t num_disks, const vector<std::pair<uint64_t, uint64_t>>& ranges,
+				     int source, int target)
+{
+    check_game(num_disks, source, target);
+    vector<uint64_t> boundaries;
+    boundaries.reserve(2 * ranges.size());
+    for (const auto& range : ranges) {
+	check_range(num_disks, range.first, range.second);
+	boundaries.push_back(range.first);
+	boundaries.push_back(range.second);
+    }
+    std::sort(boundaries.begin(), boundaries.end());
+    boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+    vector<RangeStats> prefixes;
+    prefixes.reserve(boundaries.size());
+    for (uint64_t boundary : boundaries) {
+	prefixes.push_back(prefix_stats(num_disks, boundary, source, target));
+    }
+    auto prefix = [&](uint64_t boundary) -> const RangeStats& {
+	return prefixes[std::lower_bound(boundaries.begin(), boundaries.end(), boundary) - boundaries.begin()];
+    };
+
+    vector<RangeStats> stats;
+    stats.reserve(ranges.size());
+    for (const auto& range : ranges) {
+	stats.push_back(difference(prefix(range.second), prefix(range.first)));
+    }
+    return stats;
+}
+
+
+string range_stats_json(const RangeStats& stats)
+{
+    string json = "{\"disks\":" + std::to_string(stats.num_disks) + ",\"first\":" + std::to_string(stats.first) +
+		  ",\"end\":" + std::to_string(stats.end) + ",\"moves_per_disk\":[";
+    for (size_t disk = 0; disk < stats.num_disks; ++disk) {
+	json += (disk == 0 ? "" : ",") + std::to_string(stats.moves_per_disk[disk]);
+    }
+    json += "],\"traffic\":{";
+    bool first = true;
+    for (int from = 0; from < 3; ++from) {
+	for (int to = 0; to < 3; ++to) {
+	    if (from != to) {
+		json += string(first ? "" : ",") + "\"" + std::to_string(from) + "->" + std::to_string(to) + "\":" +
+			std::to_string(stats.traffic[from][to]);
+		first = false;
+	    }
+	}
+    }
+    json += "},\"time_on_tower\":[";
+    for (size_t disk = 0; disk < stats.num_disks; ++disk) {
+	json += string(disk == 0 ? "" : ",") + "[" + std::to_string(stats.time_on_tower[disk][0]) + "," +
+		std::to_string(stats.time_on_tower[disk][1]) + "," + std::to_string(stats.time_on_tower[disk][2]) + "]";
+    }
+    json += "]}";
+    return json;
+}
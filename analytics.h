@@ -0,0 +1,74 @@
+#ifndef ANALYTICS_H
+#define ANALYTICS_H
+
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+#include <utility>   // for std::pair
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+/*
+ * Statistics over a range [first, end) of the moves of a solution, without making any of the moves.
+ *
+ * The solution is the same binary counter as Hanoi::add_one(): move k moves the disk of the lowest 1 bit of k + 1,
+ * so disk d makes its j-th move (counting from 0) at move 2^d * (2j + 1) - 1, and it makes
+ * ((k >> d) + 1) >> 1 moves among the first k moves. Each disk always steps around the towers in the same direction,
+ * so where it is after j of its moves is just j modulo 3. That makes every statistic a few shifts per disk:
+ * O(num_disks) for a range, however many moves it has.
+ */
+
+// The largest number of disks, so that every count fits into 64 bits.
+#define MAX_ANALYTICS_DISKS 63
+
+struct RangeStats {
+    size_t num_disks;
+    // The range.
+    uint64_t first;
+    uint64_t end;
+    // moves_per_disk[d] is the number of moves of disk d in the range.
+    uint64_t moves_per_disk[MAX_ANALYTICS_DISKS];
+    // traffic[from][to] is the number of moves in the range which go from one tower to another.
+    uint64_t traffic[3][3];
+    // time_on_tower[d][t] is the number of moves in the range which start while disk d is on tower t
+    // (including the moves of disk d itself, which start with it on the tower it leaves).
+    uint64_t time_on_tower[MAX_ANALYTICS_DISKS][3];
+};
+
+/**
+ * The statistics of one range, in O(num_disks) time.
+ * Throws std::invalid_argument if the number of disks or the range is invalid.
+ *
+ * @param size_t num_disks - The number of disks, 1 ... MAX_ANALYTICS_DISKS.
+ * @param uint64_t first   - The first move of the range.
+ * @param uint64_t end     - One past the last move of the range, first ... 2^num_disks - 1.
+ * @param int source       - The tower where all the disks start, 0 ... 2.
+ * @param int target       - The tower where all the disks end up, 0 ... 2, != source.
+ * @return RangeStats - The statistics.
+ */
+RangeStats range_stats(size_t num_disks, uint64_t first, uint64_t end, int source = 0, int target = 2);
+
+/**
+ * The statistics of many ranges of the same solution.
+ * Every statistic of [first, end) is the statistic of [0, end) minus the statistic of [0, first),
+ * so the statistics are worked out once for each distinct boundary, and each range is then a subtraction.
+ * Ranges which share their boundaries (such as consecutive pages of a report) cost about half as much.
+ * Throws std::invalid_argument if the number of disks or any range is invalid.
+ *
+ * @param size_t num_disks                                    - The number of disks, 1 ... MAX_ANALYTICS_DISKS.
+ * @param const vector<std::pair<uint64_t, uint64_t>>& ranges - The ranges, as (first, end) pairs.
+ * @return vector<RangeStats> - The statistics of each range, in the same order.
+ */
+vector<RangeStats> range_stats_batch(size_t num_disks, const vector<std::pair<uint64_t, uint64_t>>& ranges,
+				     int source = 0, int target = 2);
+
+/**
+ * @return string - The statistics as one line of JSON.
+ */
+string range_stats_json(const RangeStats& stats);
+
+#endif /* ANALYTICS_H */
@@ -0,0 +1,467 @@
+#include "batch.h"
+#include "move_stream.h"
+#include "solver.h"
+#include "state.h"
+
+#include <algorithm>           // for std::copy, std::min, std::max
+#include <atomic>              // for std::atomic
+#include <condition_variable>  // for std::condition_variable
+#include <deque>               // for std::deque
+#include <exception>           // for std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <mutex>               // for std::mutex, std::lock_guard, std::unique_lock
+#include <random>              // for std::mt19937
+#include <stdexcept>           // for std::invalid_argument
+#include <thread>              // for std::thread
+
+
+namespace {
+
+// The moves are handed to the sinks in chunks of this many moves.
+const size_t CHUNK_MOVES = 256;
+
+// A piece of work: the whole puzzle, or the moves first ... last - 1 of a STANDARD puzzle.
+struct Task {
+    size_t puzzle;
+    MoveIndex first;
+    MoveIndex last;
+};
+
+// The queue of one thread. The owner takes tasks from the back, the thieves take them from the front,
+// so a thief gets the oldest task, which is the largest piece of a split puzzle.
+struct TaskQueue {
+    std::mutex lock;
+    std::deque<Task> tasks;
+};
+
+// The state shared by all the threads while one batch is being solved.
+class Batch {
+  public:
+    Batch(const vector<PuzzleSpec>& puzzles, const vector<MoveSink*>& sinks, size_t num_threads, uint64_t split_moves)
+	: puzzles{puzzles}, sinks{sinks}, split_moves{split_moves}, queues(num_threads), pending(puzzles.size()), failed{false}
+    {
+	// Deal the puzzles out to the threads like cards.
+	for (size_t i = 0; i < puzzles.size(); ++i) {
+	    Task task{i, 0, 0};
+	    if (puzzles[i].kind == PuzzleKind::STANDARD) {
+		task.first = puzzles[i].first;
+		task.last  = puzzles[i].last.is_zero() ? Solver(puzzles[i].num_disks).total_moves() : puzzles[i].last;
+	    }
+	    pending[i] = 1;
+	    queues[i % num_threads].tasks.push_back(task);
+	}
+	outstanding = puzzles.size();
+	queued = puzzles.size();
+    }
+
+    // Runs the threads and returns when all the tasks are done.
+    // If a task throws, the threads stop taking tasks, and the first exception is rethrown once they have all stopped.
+    void run()
+    {
+	vector<std::thread> threads;
+	for (size_t i = 1; i < queues.size(); ++i) {
+	    threads.emplace_back(&Batch::work, this, i);
+	}
+	// The calling thread is one of the workers.
+	work(0);
+	for (std::thread& thread : threads) {
+	    thread.join();
+	}
+	if (error) {
+	    std::rethrow_exception(error);
+	}
+    }
+
+  private:
+    // The loop of one thread: its own tasks first, then stolen tasks, until there are no tasks left anywhere.
+    // A thread which finds no task sleeps until a task is pushed, the batch is done, or a task has failed.
+    void work(size_t self)
+    {
+	Task task;
+	while (outstanding != 0 && !failed) {
+	    if (pop(self, task) || steal(self, task)) {
+		try {
+		    run_task(self, task);
+		} catch (...) {
+		    fail(std::current_exception());
+		}
+	    } else {
+		std::unique_lock<std::mutex> guard(idle_lock);
+		idle.wait(guard, [this] { return queued != 0 || outstanding == 0 || failed; });
+	    }
+	}
+    }
+
+    // Wakes up all the sleeping threads, after the state they wait for has changed.
+    void wake_all()
+    {
+	// Taking the lock makes sure that a thread which has just found nothing to do is already waiting.
+	{ std::lock_guard<std::mutex> guard(idle_lock); }
+	idle.notify_all();
+    }
+
+    // Keeps the first exception thrown by a task, and stops all the threads.
+    void fail(std::exception_ptr exception)
+    {
+	{
+	    std::lock_guard<std::mutex> guard(idle_lock);
+	    if (!error) {
+		error = exception;
+	    }
+	    failed = true;
+	}
+	idle.notify_all();
+    }
+
+    bool pop(size_t self, Task& task)
+    {
+	std::lock_guard<std::mutex> guard(queues[self].lock);
+	if (queues[self].tasks.empty()) {
+	    return false;
+	}
+	task = std::move(queues[self].tasks.back());
+	queues[self].tasks.pop_back();
+	--queued;
+	return true;
+    }
+
+    bool steal(size_t self, Task& task)
+    {
+	for (size_t i = 1; i < queues.size(); ++i) {
+	    TaskQueue& victim = queues[(self + i) % queues.size()];
+	    std::lock_guard<std::mutex> guard(victim.lock);
+	    if (!victim.tasks.empty()) {
+		task = std::move(victim.tasks.front());
+		victim.tasks.pop_front();
+		--queued;
+		return true;
+	    }
+	}
+	return false;
+    }
+
+    void push(size_t self, Task task)
+    {
+	{
+	    std::lock_guard<std::mutex> guard(queues[self].lock);
+	    queues[self].tasks.push_back(std::move(task));
+	    ++queued;
+	}
+	{ std::lock_guard<std::mutex> guard(idle_lock); }
+	idle.notify_one();
+    }
+
+    void run_task(size_t self, Task& task)
+    {
+	const PuzzleSpec& spec = puzzles[task.puzzle];
+	MoveSink* sink = sinks[task.puzzle];
+	Move buffer[CHUNK_MOVES];
+	size_t count = 0;
+	// The index of buffer[0] within the solution.
+	MoveIndex chunk_first = task.first;
+
+	if (spec.kind == PuzzleKind::STANDARD) {
+	    // Keep the first half, leave the second half for whoever gets to it first.
+	    while (task.last - task.first > MoveIndex(split_moves)) {
+		MoveIndex middle = task.first + ((task.last - task.first) >> 1);
+		++pending[task.puzzle];
+		++outstanding;
+		push(self, Task{task.puzzle, middle, task.last});
+		task.last = middle;
+	    }
+
+	    Solver solver(spec.num_disks, spec.source, spec.target);
+	    solver.seek(task.first);
+	    for (uint64_t left = (task.last - task.first).to_u64(); left != 0; --left) {
+		buffer[count++] = solver.next();
+		if (count == CHUNK_MOVES) {
+		    sink->consume(chunk_first, buffer, count);
+		    chunk_first += MoveIndex(count);
+		    count = 0;
+		}
+	    }
+	} else {
+	    Generator<Move> moves = spec.kind == PuzzleKind::FROM_STATE
+		? stream_moves_from(spec.start, spec.target)
+		: stream_moves_towers(spec.num_disks, spec.num_towers, spec.source, spec.target);
+	    while (moves.next()) {
+		buffer[count++] = moves.value();
+		if (count == CHUNK_MOVES) {
+		    sink->consume(chunk_first, buffer, count);
+		    chunk_first += MoveIndex(count);
+		    count = 0;
+		}
+	    }
+	}
+
+	if (count != 0) {
+	    sink->consume(chunk_first, buffer, count);
+	}
+
+	// The last piece of a puzzle to finish tells its sink.
+	if (--pending[task.puzzle] == 0) {
+	    sink->finish();
+	}
+	if (--outstanding == 0) {
+	    wake_all();
+	}
+    }
+
+    const vector<PuzzleSpec>& puzzles;
+    const vector<MoveSink*>& sinks;
+    uint64_t split_moves;
+
+    vector<TaskQueue> queues;
+    // The number of unfinished pieces of each puzzle.
+    vector<std::atomic<size_t>> pending;
+    // The number of unfinished tasks of the whole batch.
+    std::atomic<size_t> outstanding;
+    // The number of tasks in all the queues.
+    std::atomic<size_t> queued;
+
+    // The idle threads sleep on idle, and the threads which change what they wait for notify it under idle_lock.
+    std::mutex idle_lock;
+    std::condition_variable idle;
+    // Set once a task has thrown.
+    std::atomic<bool> failed;
+    std::exception_ptr error;
+};
+
+bool valid_tower(int tower, int num_towers)
+{
+    return tower >= 0 && tower < num_towers;
+}
+
+// Throws std::invalid_argument if the puzzle can not be solved.
+void check_puzzle(const PuzzleSpec& spec)
+{
+    switch (spec.kind) {
+      case PuzzleKind::STANDARD:
+	  if (!valid_tower(spec.source, 3) || !valid_tower(spec.target, 3) || spec.source == spec.target) {
+	      throw std::invalid_argument("BatchSolver: invalid towers");
+	  }
+	  if (!spec.last.is_zero() && (spec.first > spec.last || spec.last > Solver(spec.num_disks).total_moves())) {
+	      throw std::invalid_argument("BatchSolver: invalid move range");
+	  }
+	  if (spec.last.is_zero() && spec.first > Solver(spec.num_disks).total_moves()) {
+	      throw std::invalid_argument("BatchSolver: invalid move range");
+	  }
+	  break;
+      case PuzzleKind::FROM_STATE:
+	  if (!valid_tower(spec.target, 3)) {
+	      throw std::invalid_argument("BatchSolver: invalid towers");
+	  }
+	  for (unsigned char tower : spec.start) {
+	      if (!valid_tower(tower, 3)) {
+		  throw std::invalid_argument("BatchSolver: invalid start state");
+	      }
+	  }
+	  break;
+      case PuzzleKind::TOWERS:
+	  if (spec.num_towers < 3 || spec.num_towers > 64) {
+	      throw std::invalid_argument("BatchSolver: the number of towers must be 3 ... 64");
+	  }
+	  if (!valid_tower(spec.source, spec.num_towers) || !valid_tower(spec.target, spec.num_towers) || spec.source == spec.target) {
+	      throw std::invalid_argument("BatchSolver: invalid towers");
+	  }
+	  break;
+    }
+}
+
+/**
+ * Collects the moves of one puzzle of check_batch(), and checks them when the puzzle finishes.
+ * The chunks of a STANDARD puzzle are put into place by their index, since they come in any order.
+ */
+class CheckSink : public MoveSink {
+  public:
+    CheckSink(const PuzzleSpec& spec) : spec{spec}, received{0}, out_of_range{false}, finished{false}
+    {
+	size_t num_disks = spec.kind == PuzzleKind::FROM_STATE ? spec.start.size() : spec.num_disks;
+	if (spec.kind == PuzzleKind::STANDARD) {
+	    Solver solver(num_disks, spec.source, spec.target);
+	    MoveIndex last = spec.last.is_zero() ? solver.total_moves() : spec.last;
+	    solver.seek(spec.first);
+	    start = solver.getTowers();
+	    solver.seek(last);
+	    end = solver.getTowers();
+	    expected = (last - spec.first).to_u64();
+	    moves.resize(expected);
+	} else if (spec.kind == PuzzleKind::FROM_STATE) {
+	    start = spec.start;
+	    end.assign(num_disks, spec.target);
+	    expected = moves_to_tower(spec.start, num_disks, spec.target).to_u64();
+	} else {
+	    start.assign(num_disks, spec.source);
+	    end.assign(num_disks, spec.target);
+	    // The fewest moves on more than three towers are not known, so only the towers are checked.
+	    expected = 0;
+	}
+    }
+
+    void consume(const MoveIndex& first, const Move* chunk, size_t count) override
+    {
+	received += count;
+	if (spec.kind != PuzzleKind::STANDARD) {
+	    moves.insert(moves.end(), chunk, chunk + count);
+	    return;
+	}
+	MoveIndex offset = first - spec.first;
+	if (first < spec.first || offset + MoveIndex(count) > MoveIndex(moves.size())) {
+	    out_of_range = true;
+	    return;
+	}
+	std::copy(chunk, chunk + count, moves.begin() + offset.to_u64());
+    }
+
+    void finish() override { finished = true; }
+
+    /**
+     * @return string - What is wrong with the moves, or an empty string if nothing is.
+     */
+    string check() const
+    {
+	if (!finished) {
+	    return "finish() was not called";
+	}
+	if (out_of_range) {
+	    return "a chunk is outside of the moves";
+	}
+	if (spec.kind != PuzzleKind::TOWERS && received != expected) {
+	    return std::to_string(received) + " moves instead of " + std::to_string(expected);
+	}
+	int num_towers = spec.kind == PuzzleKind::TOWERS ? spec.num_towers : 3;
+	vector<unsigned char> towers = start;
+	for (size_t i = 0; i < moves.size(); ++i) {
+	    const Move& move = moves[i];
+	    bool legal = move.disk < towers.size() && move.from != move.to && move.to >= 0 && move.to < num_towers &&
+			 towers[move.disk] == move.from;
+	    // No smaller disk may be on top of the disk, or on the tower it goes to.
+	    for (size_t smaller = 0; legal && smaller < move.disk; ++smaller) {
+		legal = towers[smaller] != move.from && towers[smaller] != move.to;
+	    }
+	    if (!legal) {
+		return "move " + std::to_string(i) + " (disk " + std::to_string(move.disk) + " " + std::to_string(move.from) +
+		       "->" + std::to_string(move.to) + ") is not legal";
+	    }
+	    towers[move.disk] = move.to;
+	}
+	if (towers != end) {
+	    return "the disks do not end up where they should";
+	}
+	return "";
+    }
+
+    uint64_t getReceived() const { return received; }
+
+  private:
+    const PuzzleSpec& spec;
+    vector<unsigned char> start;
+    vector<unsigned char> end;
+    uint64_t expected;
+    vector<Move> moves;
+    // The chunks of a STANDARD puzzle are consumed by several workers at once.
+    std::atomic<uint64_t> received;
+    std::atomic<bool> out_of_range;
+    bool finished;
+};
+
+string describe(const PuzzleSpec& spec)
+{
+    switch (spec.kind) {
+      case PuzzleKind::STANDARD:
+	  return std::to_string(spec.num_disks) + " disks from tower " + std::to_string(spec.source) + " to tower " +
+		 std::to_string(spec.target) + ", moves " + spec.first.to_string() + " ... " +
+		 (spec.last.is_zero() ? string("the end") : spec.last.to_string());
+      case PuzzleKind::FROM_STATE: {
+	  string start;
+	  for (size_t disk = spec.start.size(); disk-- > 0;) {
+	      start += char('0' + spec.start[disk]);
+	  }
+	  return std::to_string(spec.start.size()) + " disks from " + start + " (largest disk first) to tower " +
+		 std::to_string(spec.target);
+      }
+      case PuzzleKind::TOWERS:
+	  return std::to_string(spec.num_disks) + " disks on " + std::to_string(spec.num_towers) + " towers from tower " +
+		 std::to_string(spec.source) + " to tower " + std::to_string(spec.target);
+    }
+    return "";
+}
+
+}  // namespace
+
+
+BatchSolver::BatchSolver(size_t num_threads, uint64_t split_moves) : num_threads{num_threads}, split_moves{split_moves}
+{
+    if (this->num_threads == 0) {
+	this->num_threads = std::thread::hardware_concurrency();
+    }
+    if (this->num_threads == 0) {
+	this->num_threads = 1;
+    }
+    if (this->split_moves == 0) {
+	this->split_moves = 1;
+    }
+}
+
+
+void BatchSolver::solve(const vector<PuzzleSpec>& puzzles, const vector<MoveSink*>& sinks)
+{
+    if (sinks.size() != puzzles.size()) {
+	throw std::invalid_argument("BatchSolver: one sink is needed for each puzzle");
+    }
+    for (const PuzzleSpec& spec : puzzles) {
+	check_puzzle(spec);
+    }
+    if (puzzles.empty()) {
+	return;
+    }
+
+    Batch batch(puzzles, sinks, num_threads, split_moves);
+    batch.run();
+}
+
+
+BatchReport check_batch(size_t num_puzzles, size_t max_disks, size_t num_threads, uint64_t split_moves)
+{
+    std::mt19937 random(2018);
+    vector<PuzzleSpec> puzzles(num_puzzles);
+    for (size_t i = 0; i < num_puzzles; ++i) {
+	PuzzleSpec& spec = puzzles[i];
+	spec.kind = PuzzleKind(i % 3);
+	spec.num_disks = 1 + random() % max_disks;
+	spec.num_towers = spec.kind == PuzzleKind::TOWERS ? 3 + random() % 4 : 3;
+	spec.source = random() % spec.num_towers;
+	spec.target = (spec.source + 1 + random() % (spec.num_towers - 1)) % spec.num_towers;
+	if (spec.kind == PuzzleKind::STANDARD && i % 2 == 0) {
+	    // A window of the solution.
+	    uint64_t total = Solver(spec.num_disks).total_moves().to_u64();
+	    uint64_t a = random() % (total + 1);
+	    uint64_t b = random() % (total + 1);
+	    spec.first = std::min(a, b);
+	    spec.last  = std::max(a, b);
+	    // A window which ends at 0 is the whole rest of the solution.
+	} else if (spec.kind == PuzzleKind::FROM_STATE) {
+	    spec.start.resize(spec.num_disks);
+	    for (unsigned char& tower : spec.start) {
+		tower = random() % 3;
+	    }
+	}
+    }
+
+    std::deque<CheckSink> sinks;
+    vector<MoveSink*> sink_pointers;
+    for (const PuzzleSpec& spec : puzzles) {
+	sinks.emplace_back(spec);
+	sink_pointers.push_back(&sinks.back());
+    }
+    BatchSolver(num_threads, split_moves).solve(puzzles, sink_pointers);
+
+    BatchReport report{num_puzzles, 0, {}};
+    for (size_t i = 0; i < num_puzzles; ++i) {
+	report.moves += sinks[i].getReceived();
+	string mismatch = sinks[i].check();
+	if (!mismatch.empty()) {
+	    report.mismatches.push_back(describe(puzzles[i]) + ": " + mismatch);
+	}
+    }
+    return report;
+}
@@ -0,0 +1,129 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "move.h"
+#include "move_index.h"
+
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+// The kinds of puzzles which the BatchSolver can solve (see move_stream.h).
+enum class PuzzleKind {
+    // All the disks go from source to target on three towers.
+    STANDARD,
+    // The disks start from any legal arrangement and all go to target on three towers.
+    FROM_STATE,
+    // All the disks go from source to target on num_towers towers.
+    TOWERS
+};
+
+// Describes one puzzle of a batch.
+struct PuzzleSpec {
+    PuzzleKind kind = PuzzleKind::STANDARD;
+    // The number of disks. Ignored for FROM_STATE, where it is start.size().
+    size_t num_disks = 0;
+    // The number of towers. Used only by TOWERS.
+    int num_towers = 3;
+    // The tower where all the disks start. Ignored for FROM_STATE.
+    int source = 0;
+    // The tower where all the disks end up.
+    int target = 2;
+    // start[i] is the tower where disk i starts. Used only by FROM_STATE.
+    vector<unsigned char> start;
+    // Used only by STANDARD: only the moves first ... last - 1 are solved.
+    // If last is 0, the solution is solved to its end.
+    MoveIndex first;
+    MoveIndex last;
+};
+
+/**
+ * Receives the moves of one puzzle.
+ *
+ * The moves come in chunks, each one with the index of its first move within the solution.
+ * A STANDARD puzzle is split into pieces which are solved by different threads at the same time,
+ * so consume() may be called from several threads at once, and the chunks may come in any order.
+ * The other kinds of puzzles are solved by a single thread, in order.
+ * finish() is called once, after the last chunk of the puzzle.
+ */
+class MoveSink {
+  public:
+    virtual ~MoveSink() {}
+
+    /**
+     * @param const MoveIndex& first - The index of moves[0] within the solution.
+     * @param const Move* moves      - The moves of the chunk.
+     * @param size_t count           - The number of moves in the chunk.
+     */
+    virtual void consume(const MoveIndex& first, const Move* moves, size_t count) = 0;
+
+    virtual void finish() {}
+};
+
+/**
+ * Solves many unrelated puzzles at once on a pool of threads.
+ *
+ * Each thread has its own queue of tasks. When its queue is empty, it steals a task from another thread,
+ * and when there is nothing to steal either, it sleeps until another thread pushes a task.
+ * A STANDARD puzzle with more than split_moves moves keeps being cut in half by the thread which runs it:
+ * the second half goes onto its queue, where an idle thread can steal it (see Solver::seek()).
+ * This way one huge puzzle is shared by all the threads, and it balances against many small ones.
+ *
+ * No Tower or Disk is allocated, each thread just keeps a Solver and a small buffer of moves for its current task.
+ */
+class BatchSolver {
+  public:
+    /**
+     * @param size_t num_threads  - The number of threads. 0 means one thread per core.
+     * @param uint64_t split_moves - STANDARD puzzles are split into pieces of at most this many moves.
+     */
+    BatchSolver(size_t num_threads = 0, uint64_t split_moves = 1 << 16);
+
+    /**
+     * Solves all the puzzles, sending the moves of puzzles[i] to sinks[i].
+     * Returns when all the puzzles have been solved.
+     * Throws std::invalid_argument if a puzzle is not valid.
+     * If a sink (or the solving of a puzzle) throws, the threads stop taking new tasks, and solve() rethrows
+     * the first exception once they have all stopped. The puzzles which were not finished then get no finish().
+     *
+     * @param const vector<PuzzleSpec>& puzzles - The puzzles.
+     * @param const vector<MoveSink*>& sinks    - One sink for each puzzle.
+     */
+    void solve(const vector<PuzzleSpec>& puzzles, const vector<MoveSink*>& sinks);
+
+  private:
+    size_t num_threads;
+    uint64_t split_moves;
+};
+
+// What check_batch() found.
+struct BatchReport {
+    // The number of puzzles.
+    uint64_t puzzles;
+    // The number of moves checked, over all the puzzles.
+    uint64_t moves;
+    // A description of every puzzle whose moves were wrong.
+    vector<string> mismatches;
+};
+
+/**
+ * The check of the BatchSolver: solves a batch of random puzzles of every kind, some of them only a window
+ * of their solution, and checks the moves of each puzzle once it finishes. The moves must all be legal,
+ * they must bring the disks from where they start to where they should end up, and except for TOWERS puzzles
+ * there must be the fewest possible of them.
+ *
+ * @param size_t num_puzzles   - The number of puzzles.
+ * @param size_t max_disks     - The largest number of disks of a puzzle.
+ * @param size_t num_threads   - The number of threads, 0 means one thread per core.
+ * @param uint64_t split_moves - See BatchSolver.
+ * @return BatchReport - The puzzles, and the mismatches.
+ */
+BatchReport check_batch(size_t num_puzzles, size_t max_disks, size_t num_threads, uint64_t split_moves);
+
+#endif /* BATCH_H */
@@ -0,0 +1,146 @@
+#include "checkpoint.h"
+#include "protocol.h"
+
+#include <cerrno>     // for errno, ENOENT
+#include <cstdio>     // for std::rename, std::remove
+#include <cstring>    // for std::strerror, std::memcmp
+#include <stdexcept>  // for std::runtime_error, std::invalid_argument
+
+#include <fcntl.h>    // for open, O_WRONLY, O_CREAT, O_TRUNC, O_RDONLY, O_DIRECTORY
+#include <unistd.h>   // for write, read, fsync, close
+
+
+namespace {
+
+// The first bytes of every checkpoint file.
+const char MAGIC[8] = {'H', 'A', 'N', 'O', 'I', 'C', 'K', '1'};
+
+// 64-bit FNV-1a hash, used as the checksum of the file.
+uint64_t checksum(const string& data)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : data) {
+	hash ^= uint8_t(c);
+	hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void fail(const string& what)
+{
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+}  // namespace
+
+
+Checkpointer::Checkpointer(const string& path, uint64_t interval)
+    : path{path}, interval{interval == 0 ? 1 : interval}, countdown{this->interval}
+{
+}
+
+
+bool Checkpointer::load(Checkpoint& checkpoint) const
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+	if (errno == ENOENT) {
+	    return false;
+	}
+	fail("open " + path);
+    }
+    string data;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = read(fd, buffer, sizeof(buffer))) > 0) {
+	data.append(buffer, count);
+    }
+    close(fd);
+    if (count < 0) {
+	fail("read " + path);
+    }
+
+    // The same encoding as the query server messages (see protocol.h), between the magic and the checksum.
+    if (data.size() < sizeof(MAGIC) + 8 || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+	throw std::runtime_error("not a checkpoint file: " + path);
+    }
+    string body = data.substr(0, data.size() - 8);
+    MessageReader trailer(data.data() + body.size(), 8);
+    if (trailer.get_u64() != checksum(body)) {
+	throw std::runtime_error("damaged checkpoint file: " + path);
+    }
+
+    try {
+	MessageReader reader(body.data() + sizeof(MAGIC), body.size() - sizeof(MAGIC));
+	checkpoint.num_disks     = reader.get_u64();
+	checkpoint.position      = reader.get_index();
+	checkpoint.end           = reader.get_index();
+	checkpoint.output_offset = reader.get_u64();
+	checkpoint.towers        = reader.get_state(checkpoint.num_disks);
+    } catch (const std::invalid_argument&) {
+	throw std::runtime_error("damaged checkpoint file: " + path);
+    }
+    return true;
+}
+
+
+void Checkpointer::save(const Checkpoint& checkpoint) const
+{
+    MessageWriter writer;
+    writer.put_u64(checkpoint.num_disks);
+    writer.put_index(checkpoint.position);
+    writer.put_index(checkpoint.end);
+    writer.put_u64(checkpoint.output_offset);
+    writer.put_state(checkpoint.towers);
+
+    string data(MAGIC, sizeof(MAGIC));
+    data += writer.getBuffer();
+    MessageWriter trailer;
+    trailer.put_u64(checksum(data));
+    data += trailer.getBuffer();
+
+    // Write the temporary file, make sure it is on the disk, and only then put it in place.
+    string temp_path = path + ".tmp";
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+	fail("open " + temp_path);
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+	ssize_t count = write(fd, data.data() + written, data.size() - written);
+	if (count < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    close(fd);
+	    fail("write " + temp_path);
+	}
+	written += count;
+    }
+    if (fsync(fd) < 0) {
+	close(fd);
+	fail("fsync " + temp_path);
+    }
+    close(fd);
+    if (std::rename(temp_path.c_str(), path.c_str()) < 0) {
+	fail("rename " + temp_path);
+    }
+    // The rename itself is only on the disk once the directory is.
+    size_t slash = path.rfind('/');
+    string directory = slash == string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int directory_fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directory_fd < 0) {
+	fail("open " + directory);
+    }
+    if (fsync(directory_fd) < 0) {
+	close(directory_fd);
+	fail("fsync " + directory);
+    }
+    close(directory_fd);
+}
+
+
+void Checkpointer::remove() const
+{
+    std::remove(path.c_str());
+}
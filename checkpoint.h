@@ -0,0 +1,87 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "move_index.h"
+
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+// Everything needed to pick up a long solve where it stopped.
+struct Checkpoint {
+    // The number of disks in the game.
+    size_t num_disks = 0;
+    // The number of moves made so far, the index of the next move.
+    MoveIndex position;
+    // The index one past the last move to be made.
+    MoveIndex end;
+    // The number of bytes of output written for the moves before position.
+    uint64_t output_offset = 0;
+    // towers[i] is the tower of disk i after position moves (see Solver::getTowers()).
+    vector<unsigned char> towers;
+};
+
+/**
+ * Saves checkpoints of a long solve to a small file, and loads them back.
+ *
+ * A checkpoint is first written to a temporary file next to the checkpoint file, flushed to the disk,
+ * and then renamed over the checkpoint file, so the file always holds either the old or the new checkpoint,
+ * never half of one, even if the program is killed in the middle of saving.
+ * The file ends with a checksum, so a damaged file is recognized.
+ *
+ * The solve calls due() once per move, which just counts down, and saves a checkpoint when it returns true.
+ * The interval should be large enough that saving (which waits for the disk) costs well under 1% of the time.
+ */
+class Checkpointer {
+  public:
+    /**
+     * @param const string& path - The checkpoint file.
+     * @param uint64_t interval  - The number of moves between two checkpoints, > 0.
+     */
+    Checkpointer(const string& path, uint64_t interval);
+
+    /**
+     * @return bool - true once every interval calls.
+     */
+    inline bool due()
+    {
+	if (--countdown != 0) {
+	    return false;
+	}
+	countdown = interval;
+	return true;
+    }
+
+    /**
+     * Loads the checkpoint file.
+     * Throws std::runtime_error if the file exists but is damaged.
+     *
+     * @param Checkpoint& checkpoint - Gets the checkpoint.
+     * @return bool - true if there was a checkpoint, false if the file does not exist.
+     */
+    bool load(Checkpoint& checkpoint) const;
+
+    /**
+     * Saves a checkpoint atomically, replacing the previous one.
+     * Throws std::runtime_error if the file can not be written.
+     */
+    void save(const Checkpoint& checkpoint) const;
+
+    /**
+     * Removes the checkpoint file, once the solve has finished.
+     */
+    void remove() const;
+
+  private:
+    string path;
+    uint64_t interval;
+    uint64_t countdown;
+};
+
+#endif /* CHECKPOINT_H */
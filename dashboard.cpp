@@ -0,0 +1,74 @@
+#include "dashboard.h"
+#include "drawer.h"
+#include "move_stream.h"
+
+#include "SDL.h"
+
+#include <random>    // for std::mt19937
+
+
+Dashboard::Dashboard(size_t num_puzzles)
+{
+    puzzles.reserve(num_puzzles);
+    for (size_t i = 0; i < num_puzzles; ++i) {
+	size_t num_disks = 3 + (i * 5) % 8;
+	PuzzleVariant variant = PuzzleVariant(i % 3);
+	vector<unsigned char> towers(num_disks, 0);
+	std::unique_ptr<Hanoi> game;
+	Generator<Move> moves = [&] {
+	    switch (variant) {
+	      case PuzzleVariant::STANDARD:
+		  game = std::make_unique<Hanoi>(num_disks);
+		  return game->stream();
+	      case PuzzleVariant::MIDDLE_TARGET:
+		  return stream_moves(num_disks, 0, 1);
+	      default:
+		  // Every arrangement is legal: the disks on each tower are always stacked largest first.
+		  std::mt19937 random(i);
+		  for (unsigned char& tower : towers) {
+		      tower = random() % 3;
+		  }
+		  return stream_moves_from(towers, 2);
+	    }
+	}();
+	puzzles.push_back(DashboardPuzzle{variant, num_disks, towers, uint32_t(30) << (i % 5), 0, false,
+					  std::move(game), std::move(moves)});
+    }
+}
+
+
+void Dashboard::play(Drawer* draw)
+{
+    uint32_t start = SDL_GetTicks();
+    for (DashboardPuzzle& puzzle : puzzles) {
+	puzzle.next_ms = start + puzzle.interval_ms;
+    }
+
+    bool solved = false;
+    while (!solved) {
+	solved = advance(SDL_GetTicks());
+	draw->draw_dashboard(*this);
+	draw->wait_for_next_frame();
+    }
+}
+
+
+bool Dashboard::advance(uint32_t now_ms)
+{
+    bool solved = true;
+    for (DashboardPuzzle& puzzle : puzzles) {
+	// A puzzle which is faster than the frame rate makes several moves in one frame.
+	// The difference is signed, so that the schedule keeps working when SDL_GetTicks() wraps around.
+	while (!puzzle.done && int32_t(now_ms - puzzle.next_ms) >= 0) {
+	    if (puzzle.moves.next()) {
+		const Move& move = puzzle.moves.value();
+		puzzle.towers[move.disk] = move.to;
+		puzzle.next_ms += puzzle.interval_ms;
+	    } else {
+		puzzle.done = true;
+	    }
+	}
+	solved = solved && puzzle.done;
+    }
+    return solved;
+}
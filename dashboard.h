@@ -0,0 +1,88 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include "generator.h"
+#include "hanoi.h"
+#include "move.h"
+
+#include <cstdint>   // for std::uint32_t
+#include <cstdlib>   // for std::size_t
+#include <memory>    // for std::unique_ptr
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+// The largest number of puzzles on a dashboard.
+#define MAX_DASHBOARD_PUZZLES 100
+
+// The kinds of puzzles on a dashboard.
+enum class PuzzleVariant {
+    // The Hanoi game itself, from tower1 to tower3 (see Hanoi::stream()).
+    STANDARD,
+    // All the disks from tower1 to tower2 (see stream_moves()).
+    MIDDLE_TARGET,
+    // From a scrambled arrangement of the disks to tower3 (see stream_moves_from()).
+    SCRAMBLED
+};
+
+// One puzzle on a dashboard, which makes a move every interval_ms milliseconds.
+struct DashboardPuzzle {
+    PuzzleVariant variant;
+    size_t num_disks;
+    // towers[i] is the tower (0 ... 2) of disk i right now.
+    vector<unsigned char> towers;
+    uint32_t interval_ms;
+    // The SDL_GetTicks() time of the next move.
+    uint32_t next_ms;
+    bool done;
+    // The game of a STANDARD puzzle. It is declared before moves, so it is destroyed after the stream which uses it.
+    std::unique_ptr<Hanoi> game;
+    Generator<Move> moves;
+};
+
+class Drawer;
+
+/**
+ * Many independent puzzles shown side by side in one window, for comparing how the solvers behave.
+ *
+ * Each puzzle has its own number of disks, variant and pace, and advances on its own schedule:
+ * every frame, each puzzle makes all the moves which have come due since the last frame.
+ * Then the Drawer draws all the puzzles at once (see Drawer::draw_dashboard()).
+ */
+class Dashboard {
+  public:
+    /**
+     * Sets up a mix of puzzles: 3 ... 10 disks, all the variants, and moves every 30 ... 480 milliseconds.
+     *
+     * @param size_t num_puzzles - The number of puzzles, 1 ... MAX_DASHBOARD_PUZZLES.
+     */
+    Dashboard(size_t num_puzzles);
+
+    /**
+     * Plays all the puzzles until they are all solved, drawing a frame at the refresh rate of the display
+     * (see Drawer::wait_for_next_frame()).
+     *
+     * @param Drawer* draw - A Drawer object which is responsible for displaying the puzzles.
+     */
+    void play(Drawer* draw);
+
+    /**
+     * @return const vector<DashboardPuzzle>& - The puzzles, in the order they are laid out, row by row.
+     */
+    inline const vector<DashboardPuzzle>& getPuzzles() const { return puzzles; }
+
+  private:
+    /**
+     * Makes the moves of every puzzle which have come due.
+     *
+     * @param uint32_t now_ms - The SDL_GetTicks() time.
+     * @return bool - true if every puzzle is solved.
+     */
+    bool advance(uint32_t now_ms);
+
+    vector<DashboardPuzzle> puzzles;
+};
+
+#endif /* DASHBOARD_H */
@@ -1,12 +1,31 @@
 #include "hanoi.h"
 #include "drawer.h"
+#include "dashboard.h"
+#include "alloc_tracker.h"  // for ALLOC_PHASE
+#include "telemetry.h"      // for ScopedTimer
 
 #include "SDL.h"
 
+#include <algorithm>  // for std::max, std::sort
 
-Drawer::Drawer(SDL_Window* window, SDL_Renderer* renderer, size_t num_disks) : window{window}, renderer{renderer}, num_disks{num_disks}
+
+Drawer::Drawer(SDL_Window* window, SDL_Renderer* renderer, size_t num_disks)
+    : window{window}, renderer{renderer}, num_disks{num_disks}, scene{nullptr}, scene_skip{EMPTY}, vsync{false}, last_frame_ms{0},
+      background{nullptr}
 {
-    colors.resize(num_disks);
+    colors = make_colors(num_disks);
+
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0) {
+	vsync = (info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+    }
+    last_frame_ms = SDL_GetTicks();
+}
+
+
+vector<color> Drawer::make_colors(size_t num_disks)
+{
+    vector<color> colors(num_disks);
     // We need to split the color wheel (360) degrees into equidistant colors.
     // 360 degrees is split up into equal pieces, and each element in degrees holds the degree of each angle.
     vector<short> degrees(num_disks, 0);
@@ -24,6 +43,17 @@ Drawer::Drawer(SDL_Window* window, SDL_Renderer* renderer, size_t num_disks) : w
         colors[i].g = get_color_channel(degrees[i] + GREEN);
         colors[i].b = get_color_channel(degrees[i] + BLUE);
     }
+    return colors;
+}
+
+
+const vector<color>& Drawer::palette(size_t num_disks)
+{
+    auto it = palettes.find(num_disks);
+    if (it == palettes.end()) {
+	it = palettes.emplace(num_disks, make_colors(num_disks)).first;
+    }
+    return it->second;
 }
 
 
@@ -51,99 +81,234 @@ short int Drawer::get_color_channel(int num)
 }
 
 
-void Drawer::draw_Hanoi(const Hanoi& hanoi)
+void Drawer::set_scene(const Hanoi& hanoi, int skip)
 {
-    // Handle events just before drawing a "frame".
-    handleEvents();
+    ALLOC_PHASE(PHASE_RENDER);
 
-    drawBackground(renderer);
+    scene_skip = skip;
+    if (scene == nullptr) {
+	scene = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 640, 480);
+    }
+    if (scene != nullptr) {
+	SDL_SetRenderTarget(renderer, scene);
+	drawScenery(renderer);
+	drawDisks(hanoi, skip);
+	SDL_SetRenderTarget(renderer, nullptr);
+    }
+}
 
-    // The varies values get calculated during the runtime.
-    // x = varies, y = varies, w = varies, h = 15 always
-    SDL_Rect disk = { 0, 0, 0, 15};
 
-    // The first pole starts at x = 112.
-    int pole_x = 112;
-    // The bottom disk always starts flat on the floor.
-    // Each disk is 15 high.
-    int disk_y = 455;
+void Drawer::draw_frame(const Hanoi& hanoi, const Move* move, double elapsed_ms)
+{
+    ALLOC_PHASE(PHASE_RENDER);
+    ScopedTimer frame_timer(TRACE_FRAME);
 
-    // Start at the bottom disk.
-    Disk* temp = hanoi.tower1.bot_disk;
-    while (temp != nullptr) {
-        // 10 for the pole, 7 * (temp-> number + 1) on both sides.
-        disk.w = (temp->number + 1) * 7 * 2 + 10;
-        // The disk starts 7 * (temp->number + 1) before the start of the pole.
-        disk.x = pole_x - (temp->number + 1) * 7;
-        disk.y = disk_y;
+    // O(1) per frame: one copy of the scene and one disk.
+    if (scene != nullptr) {
+	SDL_RenderCopy(renderer, scene, nullptr, nullptr);
+    } else {
+	// The renderer can not draw into a texture, so the scene is drawn again every frame.
+	drawScenery(renderer);
+	drawDisks(hanoi, scene_skip);
+    }
 
-        // Draw the disk.
-        SDL_SetRenderDrawColor(renderer, colors[temp->number].r, colors[temp->number].g, colors[temp->number].b, 255);
-        SDL_RenderFillRect(renderer, &disk);
+    if (move != nullptr) {
+	// The move has already been made, so the disk is the top disk of the tower it went to.
+	const Tower* towers[3] = { &hanoi.tower1, &hanoi.tower2, &hanoi.tower3 };
+	// Where the disk was, on top of the disks which are still on the tower it came from.
+	SDL_Rect from = disk_rect(move->disk, move->from, towers[move->from]->getSize());
+	// Where the disk ends up.
+	SDL_Rect to = disk_rect(move->disk, move->to, towers[move->to]->getSize() - 1);
+	// The disk is lifted clear above the tops of the poles (at y = 100) to slide across.
+	const int lift_y = 100 - 15 - 10;
 
-        // Update the relevant variables.
-        temp = temp->next;
-        // Set the initial y-position of the next disk.
-        disk_y -= 20;  // Each disk is 15 high, and there is 5 space between the disks.
+	SDL_Rect disk = from;
+	if (elapsed_ms < LIFT_MS) {
+	    disk.y = interpolate(from.y, lift_y, elapsed_ms / LIFT_MS);
+	} else if (elapsed_ms < LIFT_MS + SLIDE_MS) {
+	    disk.y = lift_y;
+	    disk.x = interpolate(from.x, to.x, (elapsed_ms - LIFT_MS) / SLIDE_MS);
+	} else if (elapsed_ms < LIFT_MS + SLIDE_MS + DROP_MS) {
+	    disk.x = to.x;
+	    disk.y = interpolate(lift_y, to.y, (elapsed_ms - LIFT_MS - SLIDE_MS) / DROP_MS);
+	} else {
+	    disk = to;
+	}
+	const color& c = colors[move->disk];
+	SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, 255);
+	SDL_RenderFillRect(renderer, &disk);
     }
 
-    // The second pole starts at x = 305.
-    pole_x = 305;
+    ScopedTimer present_timer(TRACE_PRESENT);
+    SDL_RenderPresent(renderer);
+}
+
+
+void Drawer::wait_for_next_frame()
+{
+    uint32_t now = SDL_GetTicks();
+    // With vsync, SDL_RenderPresent() has already waited for the display.
+    if (!vsync) {
+	uint32_t spent = now - last_frame_ms;
+	if (spent < FRAME_MS) {
+	    ScopedTimer delay_timer(TRACE_DELAY);
+	    SDL_Delay(FRAME_MS - spent);
+	    now = SDL_GetTicks();
+	}
+    }
+    last_frame_ms = now;
+}
+
+
+SDL_Rect Drawer::disk_rect(size_t disk, int tower, size_t level)
+{
+    // The poles start at x = 112, 305 and 498.
+    const int pole_x[3] = { 112, 305, 498 };
+    SDL_Rect rect;
+    // 10 for the pole, 7 * (disk + 1) on both sides.
+    rect.w = (disk + 1) * 7 * 2 + 10;
+    // The disk starts 7 * (disk + 1) before the start of the pole.
+    rect.x = pole_x[tower] - (disk + 1) * 7;
     // The bottom disk always starts flat on the floor.
-    // Each disk is 15 high.
-    disk_y = 455;
+    // Each disk is 15 high, and there is 5 space between the disks.
+    rect.y = 455 - level * 20;
+    rect.h = 15;
+    return rect;
+}
 
-    // Start at the bottom disk.
-    temp = hanoi.tower2.bot_disk;
-    while (temp != nullptr) {
-        // 10 for the pole, 7 * (temp-> number + 1) on both sides.
-        disk.w = (temp->number + 1) * 7 * 2 + 10;
-        // The disk starts 7 * (temp->number + 1) before the start of the pole.
-        disk.x = pole_x - (temp->number + 1) * 7;
-        disk.y = disk_y;
 
-        // Draw the disk.
-        SDL_SetRenderDrawColor(renderer, colors[temp->number].r, colors[temp->number].g, colors[temp->number].b, 255);
-        SDL_RenderFillRect(renderer, &disk);
+int Drawer::interpolate(int from, int to, double t)
+{
+    // Smoothstep: the disk speeds up and slows down instead of starting and stopping abruptly.
+    t = t * t * (3 - 2 * t);
+    return from + int((to - from) * t);
+}
+
 
-        // Update the relevant variables.
-        temp = temp->next;
-        // Set the initial y-position of the next disk.
-        disk_y -= 20;  // Each disk is 15 high, and there is 5 space between the disks.
+void Drawer::drawDisks(const Hanoi& hanoi, int skip)
+{
+    const Tower* towers[3] = { &hanoi.tower1, &hanoi.tower2, &hanoi.tower3 };
+    for (int tower = 0; tower < 3; ++tower) {
+	size_t level = 0;
+	// Start at the bottom disk.
+	for (Disk* temp = towers[tower]->bot_disk; temp != nullptr; temp = temp->next, ++level) {
+	    if (temp->number == skip) {
+		continue;
+	    }
+	    SDL_Rect disk = disk_rect(temp->number, tower, level);
+	    // Draw the disk.
+	    SDL_SetRenderDrawColor(renderer, colors[temp->number].r, colors[temp->number].g, colors[temp->number].b, 255);
+	    SDL_RenderFillRect(renderer, &disk);
+	}
     }
+}
 
-    // The third pole starts at x = 498.
-    pole_x = 498;
-    // The bottom disk always starts flat on the floor.
-    // Each disk is 15 high.
-    disk_y = 455;
 
-    // Start at the bottom disk.
-    temp = hanoi.tower3.bot_disk;
-    while (temp != nullptr) {
-        // 10 for the pole, 7 * (temp-> number + 1) on both sides.
-        disk.w = (temp->number + 1) * 7 * 2 + 10;
-        // The disk starts 7 * (temp->number + 1) before the start of the pole.
-        disk.x = pole_x - (temp->number + 1) * 7;
-        disk.y = disk_y;
+void Drawer::draw_dashboard(const Dashboard& dashboard)
+{
+    ALLOC_PHASE(PHASE_RENDER);
+    ScopedTimer frame_timer(TRACE_FRAME);
+
+    handleEvents();
 
-        // Draw the disk.
-        SDL_SetRenderDrawColor(renderer, colors[temp->number].r, colors[temp->number].g, colors[temp->number].b, 255);
-        SDL_RenderFillRect(renderer, &disk);
+    // The scenery is the same for every cell and every frame, so it is drawn only once, into a texture.
+    if (background == nullptr) {
+	background = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, 640, 480);
+	if (background != nullptr) {
+	    SDL_SetRenderTarget(renderer, background);
+	    drawScenery(renderer);
+	    SDL_SetRenderTarget(renderer, nullptr);
+	}
+    }
 
-        // Update the relevant variables.
-        temp = temp->next;
-        // Set the initial y-position of the next disk.
-        disk_y -= 20;  // Each disk is 15 high, and there is 5 space between the disks.
+    const vector<DashboardPuzzle>& puzzles = dashboard.getPuzzles();
+    // The smallest square-ish grid which holds all the puzzles.
+    int columns = 1;
+    while (size_t(columns * columns) < puzzles.size()) {
+	++columns;
     }
+    int rows = (puzzles.size() + columns - 1) / columns;
+    int cell_w = 640 / columns;
+    int cell_h = 480 / rows;
+    double scale_x = cell_w / 640.0;
+    double scale_y = cell_h / 480.0;
+
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+
+    dashboard_disks.clear();
+    for (size_t i = 0; i < puzzles.size(); ++i) {
+	const DashboardPuzzle& puzzle = puzzles[i];
+	int cell_x = (i % columns) * cell_w;
+	int cell_y = (i / columns) * cell_h;
+	SDL_Rect cell = { cell_x, cell_y, cell_w, cell_h };
+	if (background != nullptr) {
+	    SDL_RenderCopy(renderer, background, nullptr, &cell);
+	} else {
+	    // The renderer can not draw into a texture, so the scenery is drawn into each cell instead.
+	    SDL_RenderSetViewport(renderer, &cell);
+	    SDL_RenderSetScale(renderer, scale_x, scale_y);
+	    drawScenery(renderer);
+	    SDL_RenderSetScale(renderer, 1, 1);
+	    SDL_RenderSetViewport(renderer, nullptr);
+	}
 
+	// The same geometry as draw_frame(), squeezed so that more than 10 disks still fit on the poles.
+	double squeeze = puzzle.num_disks > 10 ? 10.0 / puzzle.num_disks : 1.0;
+	const vector<color>& colors = palette(puzzle.num_disks);
+	const int pole_x[3] = { 112, 305, 498 };
+	// The number of disks already stacked on each tower.
+	int height[3] = { 0, 0, 0 };
+	// From the largest disk to the smallest, so each tower is stacked from the bottom up.
+	for (size_t disk = puzzle.num_disks; disk-- > 0; ) {
+	    int tower = puzzle.towers[disk];
+	    double half_width = (disk + 1) * 7 * squeeze;
+	    double y = 455 - height[tower] * 20 * squeeze;
+	    ++height[tower];
+
+	    SDL_Rect rect;
+	    rect.x = cell_x + int((pole_x[tower] - half_width) * scale_x);
+	    rect.y = cell_y + int(y * scale_y);
+	    rect.w = std::max(1, int((2 * half_width + 10) * scale_x));
+	    rect.h = std::max(1, int(15 * squeeze * scale_y));
+	    const color& c = colors[disk];
+	    dashboard_disks.emplace_back((uint32_t(c.r) << 16) | (uint32_t(c.g) << 8) | uint32_t(c.b), rect);
+	}
+    }
+
+    // One draw call per color rather than one per disk.
+    std::sort(dashboard_disks.begin(), dashboard_disks.end(),
+	      [](const std::pair<uint32_t, SDL_Rect>& a, const std::pair<uint32_t, SDL_Rect>& b) { return a.first < b.first; });
+    for (size_t i = 0; i < dashboard_disks.size(); ) {
+	uint32_t rgb = dashboard_disks[i].first;
+	batch.clear();
+	for (; i < dashboard_disks.size() && dashboard_disks[i].first == rgb; ++i) {
+	    batch.push_back(dashboard_disks[i].second);
+	}
+	SDL_SetRenderDrawColor(renderer, rgb >> 16, (rgb >> 8) & 0xFF, rgb & 0xFF, 255);
+	SDL_RenderFillRects(renderer, batch.data(), batch.size());
+    }
+
+    ScopedTimer present_timer(TRACE_PRESENT);
     SDL_RenderPresent(renderer);
-    SDL_Delay(1000);
 }
 
 
 void Drawer::drawBackground(SDL_Renderer* renderer)
 {
+    drawScenery(renderer);
+
+    // Make all the saved changes to the state show up on the screen.
+    ScopedTimer present_timer(TRACE_PRESENT);
+    SDL_RenderPresent(renderer);
+    //SDL_Delay(10000);
+}
+
+
+void Drawer::drawScenery(SDL_Renderer* renderer)
+{
+    ScopedTimer background_timer(TRACE_BACKGROUND);
+
     // Light sand tan.
     // r = 200, g = 170, b = 120. a = 255 (solid)
     SDL_SetRenderDrawColor(renderer, 200, 170, 120, 255);
@@ -173,18 +338,59 @@ void Drawer::drawBackground(SDL_Renderer* renderer)
     // r = 0, g = 0, b = 0, a = 255 (solid)
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderFillRect(renderer, &floor);
+}
 
-    // Make all the saved changes to the state show up on the screen.
-    SDL_RenderPresent(renderer);
-    //SDL_Delay(10000);
+
+bool Drawer::playback_key(SDL_Keycode key)
+{
+    switch (key) {
+      case SDLK_SPACE:
+	  inputs.push_back(PlaybackInput{PlaybackInput::PAUSE, 0});
+	  return true;
+      case SDLK_PLUS:
+      case SDLK_EQUALS:
+      case SDLK_KP_PLUS:
+	  inputs.push_back(PlaybackInput{PlaybackInput::SPEED, 1});
+	  return true;
+      case SDLK_MINUS:
+      case SDLK_KP_MINUS:
+	  inputs.push_back(PlaybackInput{PlaybackInput::SPEED, -1});
+	  return true;
+      case SDLK_RIGHT:
+	  inputs.push_back(PlaybackInput{PlaybackInput::SEEK, 1});
+	  return true;
+      case SDLK_LEFT:
+	  inputs.push_back(PlaybackInput{PlaybackInput::SEEK, -1});
+	  return true;
+    }
+    return false;
+}
+
+
+vector<PlaybackInput> Drawer::take_inputs()
+{
+    vector<PlaybackInput> taken;
+    taken.swap(inputs);
+    return taken;
 }
 
 
 void Drawer::handleEvents()
 {
+    ScopedTimer events_timer(TRACE_HANDLE_EVENTS);
+
     while (SDL_PollEvent(&event)) {
+	// How long the event waited in the queue. SDL timestamps the events in milliseconds since SDL_Init().
+	uint64_t latency_ns = uint64_t(SDL_GetTicks() - event.common.timestamp) * 1000000;
+	uint64_t now_ns = trace_now_ns();
+	record_trace(TRACE_EVENT_LATENCY, now_ns > latency_ns ? now_ns - latency_ns : 0, latency_ns);
+
         switch (event.type) {
 	  case SDL_KEYDOWN:
+	      // The playback keys are queued for whoever is playing the game (see take_inputs()).
+	      if (playback_key(event.key.keysym.sym)) {
+		  break;
+	      }
 	      // If the key pressed was 'q', it goes straight down past the if () statement.
 	      // All other keys go into the if () statement.
 	      if (event.key.keysym.sym != SDLK_q) {
@@ -9,7 +9,10 @@
 // so it's safe to write these includes here also.
 // I am writing these includes here also to explicitly specify which portions of the standard library
 // are used by the class Drawer and it's member functions.
+#include <cstdint>  // for std::uint32_t
 #include <cstdlib>  // for std::size_t
+#include <map>      // for std::map
+#include <utility>  // for std::pair
 #include <vector>   // for std::vector
 
 // This struct holds the r, g, b values representing a color.
@@ -24,6 +27,36 @@ struct color {
 #define GREEN 240
 #define BLUE  120
 
+// The phases of the animation of a move, in milliseconds:
+// the disk is lifted off its tower, slides over to the other tower, drops onto it, and rests there for a moment.
+#define LIFT_MS  150
+#define SLIDE_MS 250
+#define DROP_MS  150
+#define REST_MS  100
+
+// The whole animation of a move.
+#define MOVE_MS (LIFT_MS + SLIDE_MS + DROP_MS + REST_MS)
+
+// The time between two frames when the display does not pace them (no vsync), about 60 frames per second.
+#define FRAME_MS 16
+
+// A playback key the user pressed (see Drawer::handleEvents()).
+struct PlaybackInput {
+    enum Kind : unsigned char {
+	// Space: pause or resume.
+	PAUSE,
+	// + or -: value is +1 for faster, -1 for slower.
+	SPEED,
+	// Right or left arrow: value is +1 to jump forward, -1 to jump back.
+	SEEK
+    };
+    Kind kind;
+    int value;
+};
+
+// Forward declaration, to make Dashboard recogniziable as a data type.
+class Dashboard;
+
 /**
  * This class is responsible for drawing the state of the data structures in the class Hanoi,
  * I mean the towers with the disks on them and the disk_bits vector.
@@ -39,23 +72,52 @@ class Drawer {
     short int get_color_channel(int num);
 
     /**
-     * This function draws the Hanoi object of the game, which is simply a collection of three towers.
-     * It draws a single "frame" of the game, when the exact position of all the disks is known.
+     * Draws the scene of the next frames into a texture (if the renderer can), so that draw_frame() only has to copy it.
+     * Must be called again whenever the towers change: for every move, and after jumping to another move.
      *
-     * The current state of each tower, 1 through 3, is drawn.
-     * All the disks currently in each tower are drawn with their respective colors.
-     * The disks are drawn from the bottom to top on each tower.o
+     * @param const Hanoi& hanoi - The game.
+     * @param int skip           - The moving disk, which is not part of the scene, or EMPTY.
+     */
+    void set_scene(const Hanoi& hanoi, int skip);
+
+    /**
+     * Draws and presents one frame of the animation of a move: the scene (see set_scene()),
+     * and the moving disk where it is elapsed_ms milliseconds into the move.
+     * It does not handle events or wait for the display, so the caller controls the time.
+     *
+     * @param const Hanoi& hanoi - The game, with the move already made.
+     * @param const Move* move   - The move, or nullptr if no disk is moving.
+     * @param double elapsed_ms  - The time since the move started, 0 ... MOVE_MS.
+     */
+    void draw_frame(const Hanoi& hanoi, const Move* move, double elapsed_ms);
+
+    /**
+     * @return vector<PlaybackInput> - The playback keys pressed since the last call, oldest first.
+     *                                 Only players which support them take them (see class Session).
+     */
+    vector<PlaybackInput> take_inputs();
+
+    /**
+     * Paces the frames. When the renderer was created with SDL_RENDERER_PRESENTVSYNC and the display honors it,
+     * SDL_RenderPresent() has already waited for the display and this returns right away.
+     * Otherwise (such as with the software renderer) it sleeps until FRAME_MS after the previous frame,
+     * so the animation does not spin the CPU.
+     */
+    void wait_for_next_frame();
+
+    /**
+     * Draws all the puzzles of a dashboard in a grid which fills the window, as a single "frame".
      *
-     * This function also calls drawBackground().
-     * It first draws the background, then it draws the disks.
+     * Each cell of the grid is the same picture as draw_frame() draws, scaled down, with the disks scaled
+     * to the number of disks of that puzzle. The background, poles and floor are drawn only once,
+     * into a texture which every cell copies. The disks of all the puzzles are collected first and drawn
+     * grouped by color, with one SDL_RenderFillRects() call per color, and the frame is presented once.
      *
-     * This function also calls handleEvents() before drawing anything,
-     * so that the program will be responsive to commands from the user to terminate it.
+     * This function also calls handleEvents() before drawing anything.
      *
-     * @param const Hanoi& hanoi - The Hanoi object containing the state of the game and
-     *                             all it's respective  data structures.
+     * @param const Dashboard& dashboard - The puzzles to draw.
      */
-    void draw_Hanoi(const Hanoi& hanoi);
+    void draw_dashboard(const Dashboard& dashboard);
 
     /**
      * Draws the background over which all the disks will be drawn.
@@ -67,7 +129,7 @@ class Drawer {
 
     /**
      * This function allows the program to react to events from the outside world.
-     * This function is called inside draw_Hanoi().
+     * This function is called before every frame (see Session::play(), draw_dashboard()).
      *
      * If the user enters a large number of disks, such as 10, it will take very long for the animation
      * showing the disks moving around to stop; it will take many steps to get all the disks onto tower3.
@@ -75,6 +137,7 @@ class Drawer {
      *
      * This function gets an event from the event queue,
      * and it will close the program window if the user signals that they want to quit the program.
+     * The playback keys (space, +, -, and the left and right arrows) are queued for take_inputs().
      * If any other event will be gotten, it will simply be ignored.
      *
      * We allow the user to close the program two ways:
@@ -92,6 +155,50 @@ class Drawer {
     void handleEvents();
 
   private:
+    /**
+     * Draws the background, the poles and the floor, without presenting them.
+     */
+    void drawScenery(SDL_Renderer* renderer);
+
+    /**
+     * Draws the disks of all the towers, without presenting them.
+     *
+     * @param const Hanoi& hanoi - The game.
+     * @param int skip           - A disk which is not drawn (the moving disk), or EMPTY to draw them all.
+     */
+    void drawDisks(const Hanoi& hanoi, int skip);
+
+    /**
+     * @param size_t disk   - The number of the disk.
+     * @param int tower     - The tower, 0 ... 2.
+     * @param size_t level  - The number of disks below it on the tower.
+     * @return SDL_Rect - Where the disk is drawn.
+     */
+    static SDL_Rect disk_rect(size_t disk, int tower, size_t level);
+
+    /**
+     * @return int - The point between from and to at the fraction t (0 ... 1) of the way, eased in and out.
+     */
+    static int interpolate(int from, int to, double t);
+
+    /**
+     * Queues a playback key (see PlaybackInput).
+     * @return bool - true if it was a playback key.
+     */
+    bool playback_key(SDL_Keycode key);
+
+    /**
+     * @param size_t num_disks - The number of disks in a game.
+     * @return vector<color> - num_disks colors which are evenly spaced on the color wheel, one for each disk.
+     */
+    vector<color> make_colors(size_t num_disks);
+
+    /**
+     * @return const vector<color>& - The colors of the disks of a game with num_disks disks (see make_colors()).
+     *                                They are computed the first time and reused.
+     */
+    const vector<color>& palette(size_t num_disks);
+
     // This vector has size == num_disks, the number of disks in the game.
     // Each disk has a distinctive unique color, and each one of these elements holds the color of that disk.
     vector<color> colors;
@@ -103,6 +210,26 @@ class Drawer {
 
     // Used for event handling.
     SDL_Event event;
+
+    // The scene of the move being animated, without the moving disk. It belongs to the renderer, which destroys it.
+    SDL_Texture* scene;
+    // The disk which is not part of the scene.
+    int scene_skip;
+    // The playback keys which have not been taken yet.
+    vector<PlaybackInput> inputs;
+    // true if SDL_RenderPresent() waits for the display.
+    bool vsync;
+    // The SDL_GetTicks() time of the previous frame.
+    uint32_t last_frame_ms;
+
+    // The scenery of draw_dashboard(), drawn once. It belongs to the renderer, which destroys it.
+    SDL_Texture* background;
+    // The colors for each number of disks on the dashboard.
+    std::map<size_t, vector<color>> palettes;
+    // The disks of a dashboard frame, with their colors packed as 0xRRGGBB, and a batch of the same color.
+    // They are members so that the memory is reused from frame to frame.
+    vector<std::pair<uint32_t, SDL_Rect>> dashboard_disks;
+    vector<SDL_Rect> batch;
 };
 
 #endif /* DRAWER_H */
@@ -0,0 +1,346 @@
+#include "engine.h"
+#include "generator.h"
+#include "hanoi.h"
+#include "move_range.h"
+#include "move_stream.h"
+#include "move_table.h"
+#include "solver.h"
+
+#include <algorithm>  // for std::mismatch, std::min
+#include <atomic>     // for std::atomic
+#include <mutex>      // for std::mutex, std::lock_guard
+#include <random>     // for std::mt19937
+#include <stdexcept>  // for std::invalid_argument
+#include <thread>     // for std::thread
+#include <utility>    // for std::pair
+
+
+namespace {
+
+/**
+ * @return int - The tower where all the disks of start are, or EMPTY if they are not all on one tower.
+ */
+int single_tower(const vector<unsigned char>& start)
+{
+    for (unsigned char tower : start) {
+	if (tower != start[0]) {
+	    return EMPTY;
+	}
+    }
+    return start.empty() ? EMPTY : start[0];
+}
+
+/**
+ * The standard recursion: the num_disks smallest disks go from one tower to another.
+ */
+Generator<Move> recursive_tower(size_t num_disks, int from, int to)
+{
+    if (num_disks == 0) {
+	co_return;
+    }
+    int spare = 3 - from - to;
+    for (Move move : recursive_tower(num_disks - 1, from, spare)) {
+	co_yield move;
+    }
+    co_yield Move{num_disks - 1, from, to};
+    for (Move move : recursive_tower(num_disks - 1, spare, to)) {
+	co_yield move;
+    }
+}
+
+/**
+ * The num_disks smallest disks go from where they are in start onto one tower.
+ * A disk which is already on that tower stays there, otherwise the disks above it get out of its way onto
+ * the third tower, it makes its one move, and they follow it.
+ */
+Generator<Move> recursive_gather(const unsigned char* start, size_t num_disks, int to)
+{
+    if (num_disks == 0) {
+	co_return;
+    }
+    size_t disk = num_disks - 1;
+    if (start[disk] == to) {
+	for (Move move : recursive_gather(start, disk, to)) {
+	    co_yield move;
+	}
+	co_return;
+    }
+    int spare = 3 - start[disk] - to;
+    for (Move move : recursive_gather(start, disk, spare)) {
+	co_yield move;
+    }
+    co_yield Move{disk, start[disk], to};
+    for (Move move : recursive_tower(disk, spare, to)) {
+	co_yield move;
+    }
+}
+
+// Pulls up to count moves from a coroutine.
+size_t pull(Generator<Move>& moves, Move* out, size_t count)
+{
+    size_t made = 0;
+    while (made < count && moves.next()) {
+	out[made++] = moves.value();
+    }
+    return made;
+}
+
+class StreamEngine : public Engine {
+  public:
+    StreamEngine(const vector<unsigned char>& start, int target) : moves{stream_moves_from(start, target)} {}
+
+    size_t generate(Move* out, size_t count) override { return pull(moves, out, count); }
+
+  private:
+    Generator<Move> moves;
+};
+
+class HanoiEngine : public Engine {
+  public:
+    HanoiEngine(size_t num_disks) : game{std::make_unique<Hanoi>(num_disks)}, moves{game->stream()} {}
+
+    size_t generate(Move* out, size_t count) override { return pull(moves, out, count); }
+
+  private:
+    // The game is declared before moves, so it is destroyed after the stream which uses it.
+    std::unique_ptr<Hanoi> game;
+    Generator<Move> moves;
+};
+
+class RecursiveEngine : public Engine {
+  public:
+    RecursiveEngine(const vector<unsigned char>& start, int target)
+	: start{start}, moves{recursive_gather(this->start.data(), start.size(), target)} {}
+
+    size_t generate(Move* out, size_t count) override { return pull(moves, out, count); }
+
+  private:
+    // The coroutines read the towers of the disks from here, so it is declared before moves.
+    vector<unsigned char> start;
+    Generator<Move> moves;
+};
+
+class SolverEngine : public Engine {
+  public:
+    SolverEngine(size_t num_disks, int source, int target) : solver(num_disks, source, target) {}
+
+    size_t generate(Move* out, size_t count) override
+    {
+	size_t made = 0;
+	while (made < count && !solver.done()) {
+	    out[made++] = solver.next();
+	}
+	return made;
+    }
+
+  private:
+    Solver solver;
+};
+
+class TableEngine : public Engine {
+  public:
+    TableEngine(size_t num_disks) : next{move_table(num_disks)}, end{next + ((size_t(1) << num_disks) - 1)} {}
+
+    size_t generate(Move* out, size_t count) override
+    {
+	size_t made = std::min<size_t>(count, end - next);
+	for (size_t i = 0; i < made; ++i) {
+	    out[i] = unpack_move(next[i]);
+	}
+	next += made;
+	return made;
+    }
+
+  private:
+    const PackedMove* next;
+    const PackedMove* end;
+};
+
+class RangeEngine : public Engine {
+  public:
+    RangeEngine(size_t num_disks, int source, int target)
+	: range{MoveRange(num_disks, source, target)}, next{range.begin()} {}
+
+    size_t generate(Move* out, size_t count) override
+    {
+	size_t made = std::min<size_t>(count, range.end() - next);
+	for (size_t i = 0; i < made; ++i, ++next) {
+	    out[i] = *next;
+	}
+	return made;
+    }
+
+  private:
+    MoveRange range;
+    MoveIterator next;
+};
+
+// One game of the differential check.
+struct DiffGame {
+    vector<unsigned char> start;
+    int target;
+};
+
+string describe(const DiffGame& game)
+{
+    string start;
+    for (size_t disk = game.start.size(); disk-- > 0;) {
+	start += char('0' + game.start[disk]);
+    }
+    return std::to_string(game.start.size()) + " disks from " + start + " (largest disk first) to tower " +
+	   std::to_string(game.target);
+}
+
+/**
+ * Plays one game with the reference and with every engine at the same time, chunk by chunk,
+ * so each chunk of the reference is made once and compared with all the engines.
+ *
+ * @param const vector<string>& names - The engines.
+ * @param const DiffGame& game        - The game.
+ * @param uint64_t& runs              - The number of engines which can play the game is added to it.
+ * @param uint64_t& compared          - The number of moves compared is added to it.
+ * @return vector<string> - What went wrong with each engine which did not match the reference.
+ */
+vector<string> diff_game(const vector<string>& names, const DiffGame& game, uint64_t& runs, uint64_t& compared)
+{
+    std::unique_ptr<Engine> reference = make_engine(engine_names()[0], game.start, game.target);
+    vector<std::pair<string, std::unique_ptr<Engine>>> engines;
+    for (const string& name : names) {
+	std::unique_ptr<Engine> engine = make_engine(name, game.start, game.target);
+	if (engine != nullptr) {
+	    engines.emplace_back(name, std::move(engine));
+	}
+    }
+    runs += engines.size();
+
+    vector<string> mismatches;
+    vector<Move> expected(ENGINE_CHUNK);
+    vector<Move> actual(ENGINE_CHUNK);
+    uint64_t index = 0;
+    while (!engines.empty()) {
+	size_t expected_count = reference->generate(expected.data(), ENGINE_CHUNK);
+	for (size_t i = 0; i < engines.size();) {
+	    const string& name = engines[i].first;
+	    size_t actual_count = engines[i].second->generate(actual.data(), ENGINE_CHUNK);
+	    size_t both = std::min(expected_count, actual_count);
+	    size_t same = std::mismatch(expected.begin(), expected.begin() + both, actual.begin()).first - expected.begin();
+	    compared += same;
+	    string mismatch;
+	    if (same < both) {
+		const Move& a = actual[same];
+		const Move& e = expected[same];
+		mismatch = name + ": " + describe(game) + ": move " + std::to_string(index + same) + " is disk " +
+			   std::to_string(a.disk) + " " + std::to_string(a.from) + "->" + std::to_string(a.to) +
+			   ", expected disk " + std::to_string(e.disk) + " " + std::to_string(e.from) + "->" + std::to_string(e.to);
+	    } else if (expected_count != actual_count) {
+		mismatch = name + ": " + describe(game) + ": " + (actual_count < expected_count ? "stops" : "goes on") +
+			   " after move " + std::to_string(index + both);
+	    }
+	    // An engine is dropped at its first mismatch.
+	    if (!mismatch.empty()) {
+		mismatches.push_back(mismatch);
+		engines.erase(engines.begin() + i);
+	    } else {
+		++i;
+	    }
+	}
+	if (expected_count < ENGINE_CHUNK) {
+	    break;
+	}
+	index += ENGINE_CHUNK;
+    }
+    return mismatches;
+}
+
+}  // namespace
+
+
+const vector<string>& engine_names()
+{
+    static const vector<string> names = {"recursive", "hanoi", "solver", "stream", "table", "range"};
+    return names;
+}
+
+
+std::unique_ptr<Engine> make_engine(const string& name, const vector<unsigned char>& start, int target)
+{
+    size_t num_disks = start.size();
+    int source = single_tower(start);
+    bool standard = source == 0 && target == 2;
+    bool one_tower = source != EMPTY && source != target;
+
+    if (name == "recursive") {
+	return std::make_unique<RecursiveEngine>(start, target);
+    }
+    if (name == "hanoi") {
+	return standard ? std::make_unique<HanoiEngine>(num_disks) : nullptr;
+    }
+    if (name == "solver") {
+	return one_tower ? std::make_unique<SolverEngine>(num_disks, source, target) : nullptr;
+    }
+    if (name == "stream") {
+	return std::make_unique<StreamEngine>(start, target);
+    }
+    if (name == "table") {
+	return standard && num_disks <= MAX_TABLE_DISKS ? std::make_unique<TableEngine>(num_disks) : nullptr;
+    }
+    if (name == "range") {
+	return one_tower && num_disks <= 64 ? std::make_unique<RangeEngine>(num_disks, source, target) : nullptr;
+    }
+    throw std::invalid_argument("unknown engine: " + name);
+}
+
+
+DiffReport diff_engines(const vector<string>& engines, size_t max_disks, size_t num_scrambled, unsigned num_threads)
+{
+    // Check the names before starting any threads.
+    for (const string& name : engines) {
+	make_engine(name, vector<unsigned char>(1, 0), 2);
+    }
+
+    vector<DiffGame> games;
+    for (size_t num_disks = 1; num_disks <= max_disks; ++num_disks) {
+	games.push_back(DiffGame{vector<unsigned char>(num_disks, 0), 2});
+	games.push_back(DiffGame{vector<unsigned char>(num_disks, 1), 0});
+	std::mt19937 random(num_disks);
+	for (size_t i = 0; i < num_scrambled; ++i) {
+	    DiffGame game{vector<unsigned char>(num_disks), int(random() % 3)};
+	    for (unsigned char& tower : game.start) {
+		tower = random() % 3;
+	    }
+	    games.push_back(game);
+	}
+    }
+
+    DiffReport report{games.size(), 0, 0, {}};
+    std::atomic<size_t> next_game{0};
+    std::atomic<uint64_t> moves{0};
+    std::atomic<uint64_t> runs{0};
+    std::mutex mismatches_mutex;
+    auto work = [&] {
+	for (size_t i = next_game++; i < games.size(); i = next_game++) {
+	    uint64_t game_runs = 0;
+	    uint64_t compared = 0;
+	    vector<string> mismatches = diff_game(engines, games[i], game_runs, compared);
+	    runs += game_runs;
+	    moves += compared;
+	    if (!mismatches.empty()) {
+		std::lock_guard<std::mutex> lock(mismatches_mutex);
+		report.mismatches.insert(report.mismatches.end(), mismatches.begin(), mismatches.end());
+	    }
+	}
+    };
+
+    vector<std::thread> threads;
+    for (unsigned i = 1; i < num_threads; ++i) {
+	threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+	thread.join();
+    }
+
+    report.moves = moves;
+    report.runs = runs;
+    return report;
+}
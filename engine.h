@@ -0,0 +1,94 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include "move.h"
+
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <memory>    // for std::unique_ptr
+#include <string>    // for std::string
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+/*
+ * Interchangeable solver engines.
+ *
+ * Every engine produces the same moves: the fewest moves which bring all the disks from a start state
+ * (start[i] is the tower of disk i) onto the target tower. The engines differ only in how they get there:
+ *   hanoi     - Hanoi::stream(): the binary counter of add_one() and the linked list Towers (all the disks on tower 0 to 2).
+ *   recursive - The textbook recursion, one coroutine per level. It is the slowest and the simplest,
+ *               and it handles every start state, so it is the reference the others are checked against.
+ *   solver    - Solver::next(): the binary counter on the tower of each disk (all the disks on one tower).
+ *   stream    - stream_moves_from(): gathers the disks of any start state, then the Solver takes over.
+ *   table     - The move tables built at compile time (all the disks on tower 0 to 2, up to MAX_TABLE_DISKS disks).
+ *   range     - MoveRange, which computes each move from its index (all the disks on one tower, up to 64 disks).
+ *
+ * The engine is picked once, when the program starts (make_engine()), and the moves are pulled from it
+ * in chunks (generate()), so the virtual call is paid once per chunk rather than once per move.
+ */
+
+// The number of moves a caller should ask generate() for at a time.
+#define ENGINE_CHUNK 4096
+
+class Engine {
+  public:
+    virtual ~Engine() = default;
+
+    /**
+     * Makes the next moves.
+     *
+     * @param Move* out    - Gets the moves.
+     * @param size_t count - The largest number of moves to make.
+     * @return size_t - The number of moves made. Less than count only once the target is reached.
+     */
+    virtual size_t generate(Move* out, size_t count) = 0;
+};
+
+/**
+ * @return const vector<string>& - The names of all the engines, the reference ("recursive") first.
+ */
+const vector<string>& engine_names();
+
+/**
+ * Creates an engine. Throws std::invalid_argument if there is no engine with that name.
+ *
+ * @param const string& name                 - The name of the engine (see engine_names()).
+ * @param const vector<unsigned char>& start - start[i] is the tower (0 ... 2) where disk i starts.
+ * @param int target                         - The tower where all the disks end up, 0 ... 2.
+ * @return std::unique_ptr<Engine> - The engine, or nullptr if it can not solve a game which starts like this.
+ */
+std::unique_ptr<Engine> make_engine(const string& name, const vector<unsigned char>& start, int target);
+
+// What diff_engines() found.
+struct DiffReport {
+    // The number of games.
+    uint64_t games;
+    // The number of moves compared, over all the engine runs.
+    uint64_t moves;
+    // The number of engine runs which were compared with the reference.
+    uint64_t runs;
+    // A description of every engine run which did not match the reference.
+    vector<string> mismatches;
+};
+
+/**
+ * The differential check: plays many games with every engine and compares their moves with the reference engine,
+ * chunk by chunk, so that even games with millions of moves need only a couple of chunks of memory.
+ *
+ * The games are 1 ... max_disks disks, each from the standard start, from all the disks on tower 1 to tower 0,
+ * and from num_scrambled scrambled start states to a random tower. An engine which can not play a game skips it.
+ * The games are spread over num_threads threads.
+ *
+ * @param const vector<string>& engines - The engines to check against the reference.
+ * @param size_t max_disks              - The largest number of disks.
+ * @param size_t num_scrambled          - The number of scrambled start states for each number of disks.
+ * @param unsigned num_threads          - The number of threads, > 0.
+ * @return DiffReport - The games, and the mismatches. Only the first mismatch of an engine run is reported.
+ */
+DiffReport diff_engines(const vector<string>& engines, size_t max_disks, size_t num_scrambled, unsigned num_threads);
+
+#endif /* ENGINE_H */
@@ -0,0 +1,68 @@
+#include "frame_pool.h"
+
+#include <new>  // for ::operator new, ::operator delete
+
+
+namespace {
+
+// The size classes are multiples of 64 bytes: 64, 128, ..., 1024.
+const size_t CLASS_SIZE  = 64;
+const size_t NUM_CLASSES = 16;
+
+// A free block holds the pointer to the next free block in its first bytes.
+struct FreeBlock {
+    FreeBlock* next;
+};
+
+// The free lists of one thread. They give all their blocks back to the heap when the thread exits.
+struct FreeLists {
+    FreeBlock* heads[NUM_CLASSES] = {};
+
+    ~FreeLists()
+    {
+	for (FreeBlock*& head : heads) {
+	    while (head != nullptr) {
+		FreeBlock* temp = head;
+		head = head->next;
+		::operator delete(temp);
+	    }
+	}
+    }
+};
+
+thread_local FreeLists free_lists;
+
+}  // namespace
+
+
+void* FramePool::allocate(size_t size)
+{
+    size_t size_class = (size + CLASS_SIZE - 1) / CLASS_SIZE;
+    if (size_class == 0 || size_class > NUM_CLASSES) {
+	return ::operator new(size);
+    }
+
+    FreeBlock*& head = free_lists.heads[size_class - 1];
+    if (head != nullptr) {
+	FreeBlock* block = head;
+	head = head->next;
+	return block;
+    }
+    // The block gets the full size of its class, so it can be reused by any frame of that class.
+    return ::operator new(size_class * CLASS_SIZE);
+}
+
+
+void FramePool::deallocate(void* block, size_t size)
+{
+    size_t size_class = (size + CLASS_SIZE - 1) / CLASS_SIZE;
+    if (size_class == 0 || size_class > NUM_CLASSES) {
+	::operator delete(block);
+	return;
+    }
+
+    FreeBlock*& head = free_lists.heads[size_class - 1];
+    FreeBlock* freed = static_cast<FreeBlock*>(block);
+    freed->next = head;
+    head = freed;
+}
@@ -0,0 +1,34 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <cstdlib>   // for std::size_t
+
+using std::size_t;
+
+/**
+ * A pool of memory blocks for coroutine frames (see class Generator).
+ *
+ * Creating a coroutine allocates its frame, and a program which creates millions of short-lived move streams
+ * would otherwise go to the heap for every one of them.
+ * Instead the freed frames are kept on free lists, one list per size class (multiples of 64 bytes, up to 1 KB),
+ * and the next coroutine of the same size class simply takes a frame off the list.
+ * The lists are thread_local, so no locking is needed. Larger frames go straight to the heap.
+ */
+class FramePool {
+  public:
+    /**
+     * @param size_t size - The size of the frame in bytes.
+     * @return void* - A block of at least size bytes.
+     */
+    static void* allocate(size_t size);
+
+    /**
+     * Puts the block back onto the free list of the current thread.
+     *
+     * @param void* block - A block returned by allocate().
+     * @param size_t size - The same size which was passed to allocate().
+     */
+    static void deallocate(void* block, size_t size);
+};
+
+#endif /* FRAME_POOL_H */
@@ -0,0 +1,153 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include "frame_pool.h"
+
+#include <coroutine>  // for std::coroutine_handle, std::suspend_always, std::default_sentinel_t
+#include <cstddef>    // for std::ptrdiff_t
+#include <cstdlib>    // for std::size_t
+#include <exception>  // for std::exception_ptr, std::current_exception, std::rethrow_exception
+#include <iterator>   // for std::input_iterator_tag
+#include <memory>     // for std::addressof
+#include <utility>    // for std::exchange
+
+using std::size_t;
+
+/**
+ * A lazy sequence of values produced by a C++20 coroutine, in the spirit of std::generator.
+ *
+ * A function returning Generator<T> may use co_yield to hand out values one at a time.
+ * The coroutine runs only when the consumer asks for the next value, so the consumer pulls the values
+ * whenever it wants, and it can do other work (such as I/O) in between.
+ *
+ * The values can be pulled either with next() and value(), or with a range-based for loop:
+ *
+ *     for (const Move& move : stream_moves(5)) { ... }
+ *
+ * The coroutine frame comes from FramePool, so creating many short-lived generators is cheap.
+ * A Generator can be moved but not copied. Destroying it destroys the coroutine, even if it has not finished.
+ */
+template<typename T>
+class Generator {
+  public:
+    struct promise_type {
+	// Points to the value given to the last co_yield. The value lives in the coroutine frame while it is suspended.
+	const T* current = nullptr;
+	// An exception thrown by the coroutine, rethrown to the consumer.
+	std::exception_ptr exception;
+
+	Generator get_return_object() { return Generator(std::coroutine_handle<promise_type>::from_promise(*this)); }
+	std::suspend_always initial_suspend() noexcept { return {}; }
+	std::suspend_always final_suspend() noexcept { return {}; }
+	std::suspend_always yield_value(const T& value) noexcept
+	{
+	    current = std::addressof(value);
+	    return {};
+	}
+	void return_void() noexcept {}
+	void unhandled_exception() { exception = std::current_exception(); }
+
+	static void* operator new(size_t size) { return FramePool::allocate(size); }
+	static void operator delete(void* frame, size_t size) { FramePool::deallocate(frame, size); }
+    };
+
+    typedef std::coroutine_handle<promise_type> handle_type;
+
+    class iterator {
+      public:
+	typedef std::input_iterator_tag iterator_category;
+	typedef T value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef const T* pointer;
+	typedef const T& reference;
+
+	iterator() : coroutine{nullptr} {}
+	explicit iterator(handle_type coroutine) : coroutine{coroutine} {}
+
+	inline const T& operator*() const { return *coroutine.promise().current; }
+	inline const T* operator->() const { return coroutine.promise().current; }
+
+	iterator& operator++()
+	{
+	    resume(coroutine);
+	    return *this;
+	}
+	void operator++(int) { ++*this; }
+
+	friend bool operator==(const iterator& it, std::default_sentinel_t) { return !it.coroutine || it.coroutine.done(); }
+
+      private:
+	handle_type coroutine;
+    };
+
+    Generator(Generator&& other) noexcept : coroutine{std::exchange(other.coroutine, nullptr)} {}
+
+    Generator& operator=(Generator&& other) noexcept
+    {
+	if (this != &other) {
+	    if (coroutine) {
+		coroutine.destroy();
+	    }
+	    coroutine = std::exchange(other.coroutine, nullptr);
+	}
+	return *this;
+    }
+
+    // I forbid you to copy or assign a Generator, only one consumer may own the coroutine.
+    Generator(const Generator& other) = delete;
+    Generator& operator=(const Generator& other) = delete;
+
+    ~Generator()
+    {
+	if (coroutine) {
+	    coroutine.destroy();
+	}
+    }
+
+    /**
+     * Runs the coroutine until it yields the next value or finishes.
+     *
+     * @return bool - true if there is a new value, which can be read with value().
+     *                false if the coroutine has finished, there are no more values.
+     */
+    bool next()
+    {
+	if (coroutine.done()) {
+	    return false;
+	}
+	resume(coroutine);
+	return !coroutine.done();
+    }
+
+    /**
+     * @return const T& - The value yielded last. Valid until the next call to next().
+     */
+    inline const T& value() const { return *coroutine.promise().current; }
+
+    /**
+     * Starts the coroutine. Like any input range, a Generator can only be walked once.
+     */
+    iterator begin()
+    {
+	resume(coroutine);
+	return iterator(coroutine);
+    }
+
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+  private:
+    explicit Generator(handle_type coroutine) : coroutine{coroutine} {}
+
+    // Resumes the coroutine and rethrows the exception it threw, if any.
+    static void resume(handle_type coroutine)
+    {
+	coroutine.resume();
+	if (coroutine.promise().exception) {
+	    std::rethrow_exception(coroutine.promise().exception);
+	}
+    }
+
+    handle_type coroutine;
+};
+
+#endif /* GENERATOR_H */
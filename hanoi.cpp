@@ -1,8 +1,7 @@
 #include "hanoi.h"
-#include "drawer.h"
 
 
-Hanoi::Hanoi(size_t num_disks) : num_disks{num_disks}
+Hanoi::Hanoi(size_t num_disks) : num_disks{num_disks}, hash{zobrist_hash(num_disks, 0)}
 {
     // The disk_bits vector starts out as 00...00
     disk_bits.resize(num_disks, 0);
@@ -12,14 +11,32 @@ Hanoi::Hanoi(size_t num_disks) : num_disks{num_disks}
     tower2.setNext(&tower3);
     tower3.setNext(&tower1);  // tower3's next tower is tower1.
 
+    towers[0] = &tower1;
+    towers[1] = &tower2;
+    towers[2] = &tower3;
+
     // Pushes all the disks onto tower1.
     set_init_disks();
 }
 
 
-void Hanoi::play(Drawer* draw)
+Generator<Move> Hanoi::stream()
 {
-    draw->draw_Hanoi(*this);
+    // Small games are played back from the table built at compile time.
+    const PackedMove* table = move_table(num_disks);
+    if (table != nullptr) {
+	// The table has 2^num_disks - 1 moves.
+	const PackedMove* end = table + ((size_t(1) << num_disks) - 1);
+	for (const PackedMove* it = table; it != end; ++it) {
+	    Move move = unpack_move(*it);
+	    // The disk is relinked from one tower onto the other, nothing is allocated.
+	    towers[move.to]->push_disk(towers[move.from]->pop_disk());
+	    hash ^= zobrist_move_key(move);
+
+	    co_yield move;
+	}
+	co_return;
+    }
 
     // We want all the disks to make their way onto the tower3.
     // If tower3 has num_disks on it, then we're done.
@@ -29,27 +46,42 @@ void Hanoi::play(Drawer* draw)
 	int next_disk = add_one();
 	// add_one() returns either the name of the next disk, or -1.
 	// -1 is returned if disk_bits has been reset to 00...00 and all the disks have still not been moved onto tower3.
-	// This happens when we have an odd number of disks and all the disks have been moved to tower2.
-	// We want to repeat the algorithm again in order to move all the disks from tower2 to tower3.
+	// Since the smallest disk goes the correct way around (see below), this should never happen,
+	// because all the disks are on tower3 once disk_bits gets to 11...11.
 	if (next_disk == -1) {
 	    continue;
 	}
 
 	// You always start from tower1.
 	Tower* current_tower = &tower1;
+	// The number of current_tower: 0 for tower1, 1 for tower2, 2 for tower3.
+	int current_number = 0;
 	// First we need to find in which Tower the next_disk is, and we need to pop it from that Tower.
 	// This loop searches for the Tower which has next_disk as it's top disk.
 	// This loop stops when such a Tower whose top disk is next_disk is found.
 	while (current_tower->top() != next_disk) {
 	    // Go one tower to the right.
 	    current_tower = current_tower->next;
+	    current_number = (current_number + 1) % 3;
 	}
+	int from = current_number;
 	// Since we stopped at a Tower which has next_disk as it's top disk,
-	// this command pops next_disk off that Tower.
-	current_tower->pop();
+	// this command takes next_disk off that Tower. The Disk itself is kept, and put on the other Tower below,
+	// so moving a disk does not allocate anything.
+	Disk* disk = current_tower->pop_disk();
 
 	// Now the next_disk should be placed onto a tower to the right.
 	current_tower = current_tower->next;
+	current_number = (current_number + 1) % 3;
+	// The smallest disk can always go to either of the other two towers.
+	// With an even number of disks it goes one tower to the right each time,
+	// but with an odd number of disks it has to go two towers to the right (one tower to the left),
+	// otherwise all the disks end up on tower2 instead of tower3.
+	// This way the moves are exactly the same as the moves in the move table.
+	if (next_disk == 0 && num_disks % 2 == 1) {
+	    current_tower = current_tower->next;
+	    current_number = (current_number + 1) % 3;
+	}
 	// We cannot put a larger disk on top a smaller one.
 	// If the top disk in the current tower is smaller than next_disk, we go one tower to the right.
 	//
@@ -58,11 +90,12 @@ void Hanoi::play(Drawer* draw)
 	// or it stops at an empty Tower.
 	while (current_tower->top() != EMPTY && current_tower->top() < next_disk) {
 	    current_tower = current_tower->next;
+	    current_number = (current_number + 1) % 3;
 	}
 	// Since we stopped at a Tower where next_disk can be placed,
 	// where the top disk is > next_disk or the Tower is empty,
-	// this command pushes next_disk onto that Tower.
-        current_tower->push(next_disk);
+	// this command puts next_disk onto that Tower.
+        current_tower->push_disk(disk);
 
 	/*
 	print_disk_bits();
@@ -72,11 +105,14 @@ void Hanoi::play(Drawer* draw)
 	cout << endl;
 	*/
 
-	draw->draw_Hanoi(*this);
+	Move move{size_t(next_disk), from, current_number};
+	hash ^= zobrist_move_key(move);
+	co_yield move;
     }
 }
 
 
+
 void Hanoi::set_init_disks()
 {
     // size_t(0) is a function-style cast in C++, similar to a constructor for PODs.
@@ -2,6 +2,11 @@
 #define HANOI_H
 
 #include "tower.h"
+#include "generator.h"
+#include "move.h"
+#include "move_range.h"
+#include "move_table.h"
+#include "zobrist.h"
 
 // Some of these includes are also in the file tower.h
 // However they will not be included twice because their header guards will prevent it,
@@ -38,14 +43,35 @@ class Hanoi {
     Hanoi(size_t num_disks);
 
     /**
-     * This function moves all the disks one by one from the leftmost tower (tower1) to the rightmost tower (tower3).
-     * Each iteration of the while loop it moves a single disk.
-     * Then it displays the state of the game (the state of all the three towers with their disks and the disk_bits vector).
-     * This function returns when all the disks have been placed onto the tower3, which means that the game has been solved.
+     * Plays the game lazily: each time the consumer pulls the next move, a single disk is moved
+     * and the move is handed out, so the towers always show the state right after that move.
+     * The consumer decides when (and whether) to pull the next move, so no Drawer is needed.
      *
-     * @param Drawer* draw - A Drawer object which is responsible for displaying the state of the game.
+     * If there are at most MAX_TABLE_DISKS disks, it simply walks the move table built at compile time.
+     * Otherwise each iteration of the while loop it computes and moves a single disk.
+     *
+     * Must be called only once, on a new game, and the Hanoi object must outlive the returned Generator.
+     *
+     * @return Generator<Move> - The moves of the game, from tower1 (0) to tower3 (2).
+     */
+    Generator<Move> stream();
+
+    /**
+     * Gives the moves of the whole game without playing it, so they can be used without a Drawer.
+     * The range does not allocate anything, and it can be used in a range-based for loop or with the standard algorithms.
+     * It does not change the state of the game.
+     *
+     * Throws std::invalid_argument if the game has more than 64 disks, or none.
+     *
+     * @return MoveRange - All the moves from tower1 (0) to tower3 (2).
+     */
+    inline MoveRange moves() const { return MoveRange(num_disks); }
+
+    /**
+     * @return uint64_t - The Zobrist hash of where the disks are now (see zobrist.h).
+     *                    It is kept up to date with one XOR per move, so reading it costs nothing.
      */
-    void play(Drawer* draw);
+    inline uint64_t getHash() const { return hash; }
 
   private:
     /* The private member helper functions. */
@@ -67,10 +93,10 @@ class Hanoi {
      *               The index is the position of the 2^power bit.
      *               This is the name of the next disk to be moved.
      *   This function returns int because the returned value is saved into int next_disk,
-     *   a local variable inside Hanoi::play().
+     *   a local variable inside Hanoi::stream().
      *   NOTE: a special value -1 is returned if all the bits in the disk_bits vector have been zeroed out due to roll over.
      *   When this happens it signifies that we need to repeat the process of counting up to 11...11 again.
-     *   Hanoi::play() function which calls this function knows how to handle the -1 returned value.
+     *   Hanoi::stream() function which calls this function knows how to handle the -1 returned value.
      *
      */
     int add_one();
@@ -93,6 +119,9 @@ class Hanoi {
     Tower tower1;
     Tower tower2;
     Tower tower3;
+    // towers[0] == &tower1, towers[1] == &tower2, towers[2] == &tower3.
+    // Used to look up a Tower by the number of the tower stored in a Move.
+    Tower* towers[3];
     // This vector of bools has the size of num_disks elements.
     // Each "bit" represents a disk.
     // disk_bits[0], the 2^0 "bit" represents disk 0, the smallest disk.
@@ -100,6 +129,8 @@ class Hanoi {
     // disk_bits[2], the 2^2 "bit" represents disk 2.
     // etc, etc...
     vector<bool> disk_bits;
+    // The Zobrist hash of the towers.
+    uint64_t hash;
 };
 
 #endif /* HANOI_H */
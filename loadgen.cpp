@@ -0,0 +1,320 @@
+#include "protocol.h"
+#include "solver.h"
+
+#include <algorithm>  // for std::sort
+#include <chrono>     // for std::chrono::steady_clock
+#include <cerrno>     // for errno, EAGAIN, EINTR
+#include <cstdlib>    // for std::strtoul, EXIT_SUCCESS, EXIT_FAILURE
+#include <cstring>    // for std::strcmp, std::strerror, std::memset, std::strncpy
+#include <deque>      // for std::deque
+#include <iostream>   // for std::cout, std::cerr, std::endl
+#include <memory>     // for std::unique_ptr, std::make_unique
+#include <random>     // for std::mt19937_64
+#include <string>     // for std::string
+#include <vector>     // for std::vector
+
+#include <sys/epoll.h>   // for epoll_create1, epoll_ctl, epoll_wait
+#include <sys/socket.h>  // for socket, connect, recv, send
+#include <sys/un.h>      // for sockaddr_un
+#include <unistd.h>      // for close
+
+using std::cerr;
+using std::cout;
+using std::endl;
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+ * The load generator for the query server (see server.h).
+ *
+ * It opens a number of connections to the server, keeps a fixed number of requests in flight on each one
+ * (the pipeline depth), and measures the latency of every request from the moment it was written
+ * to the moment its response was read. At the end it prints the throughput and the latency percentiles.
+ *
+ * Usage: Hanoi_Loadgen.out <socket> [--connections C] [--depth D] [--seconds S] [--disks N]
+ *                                   [--op move_at|state_at|distance|range|plan]
+ * The plan requests come from a planner on each connection, which makes the first PLAN_STATES moves of the solution
+ * over and over and replans after every move. It keeps the hash of its state up to date with one XOR per move
+ * (Solver::getHash()) and sends it along, so the server finds the plans of the states it has seen before
+ * without hashing them, and most of them should be answered from the server's plan cache.
+ */
+
+namespace {
+
+// The number of different states the planner of a connection walks through.
+const uint64_t PLAN_STATES = 256;
+
+struct Options {
+    const char* socket_path = nullptr;
+    unsigned connections = 4;
+    unsigned depth = 16;
+    unsigned seconds = 5;
+    unsigned disks = 64;
+    uint8_t op = OP_MOVE_AT;
+};
+
+// The state of one client connection.
+struct Client {
+    int fd = -1;
+    std::string input;
+    std::string output;
+    size_t written = 0;
+    // The send times of the requests in flight, in order. The server answers them in the same order.
+    std::deque<Clock::time_point> sent;
+    uint32_t next_id = 0;
+    // The game of the plan requests.
+    std::unique_ptr<Solver> planner;
+};
+
+// A random index of a move of the game with num_disks disks.
+MoveIndex random_index(std::mt19937_64& random, unsigned num_disks)
+{
+    std::vector<uint64_t> words((num_disks + 63) / 64);
+    for (uint64_t& word : words) {
+	word = random();
+    }
+    if (num_disks % 64 != 0) {
+	words.back() &= (uint64_t(1) << (num_disks % 64)) - 1;
+    }
+    // Never all 1s, which is one past the last move.
+    MoveIndex index = MoveIndex::from_words(words);
+    return index == MoveIndex::power_of_two(num_disks) - MoveIndex(1) ? MoveIndex(0) : index;
+}
+
+std::vector<unsigned char> random_state(std::mt19937_64& random, unsigned num_disks)
+{
+    std::vector<unsigned char> state(num_disks);
+    for (unsigned char& tower : state) {
+	tower = random() % 3;
+    }
+    return state;
+}
+
+// Appends one request to the output of the client.
+void send_request(Client& client, const Options& options, std::mt19937_64& random)
+{
+    MessageWriter payload;
+    payload.put_u32(options.disks);
+    switch (options.op) {
+      case OP_MOVE_AT:
+      case OP_STATE_AT:
+	  payload.put_index(random_index(random, options.disks));
+	  break;
+      case OP_DISTANCE:
+	  payload.put_state(random_state(random, options.disks));
+	  payload.put_state(random_state(random, options.disks));
+	  break;
+      case OP_RANGE:
+	  payload.put_index(random_index(random, options.disks));
+	  payload.put_u32(64);
+	  break;
+      case OP_PLAN: {
+	  Solver& planner = *client.planner;
+	  payload.put_state(planner.getTowers());
+	  payload.put_u64(planner.getHash());
+	  payload.put_u8(2);
+	  payload.put_u32(64);
+	  // Make a move, or start over.
+	  MoveIndex position = planner.position() + MoveIndex(1);
+	  if (position == planner.total_moves() || position == MoveIndex(PLAN_STATES)) {
+	      planner.seek(MoveIndex(0));
+	  } else {
+	      planner.next();
+	  }
+	  break;
+      }
+    }
+    append_frame(client.output, client.next_id++, options.op, payload.getBuffer());
+    client.sent.push_back(Clock::now());
+}
+
+bool parse_options(int argc, char* argv[], Options& options)
+{
+    if (argc < 2) {
+	return false;
+    }
+    options.socket_path = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2) {
+	const char* value = argv[i + 1];
+	if (std::strcmp(argv[i], "--connections") == 0) {
+	    options.connections = std::strtoul(value, nullptr, 10);
+	} else if (std::strcmp(argv[i], "--depth") == 0) {
+	    options.depth = std::strtoul(value, nullptr, 10);
+	} else if (std::strcmp(argv[i], "--seconds") == 0) {
+	    options.seconds = std::strtoul(value, nullptr, 10);
+	} else if (std::strcmp(argv[i], "--disks") == 0) {
+	    options.disks = std::strtoul(value, nullptr, 10);
+	} else if (std::strcmp(argv[i], "--op") == 0) {
+	    if (std::strcmp(value, "move_at") == 0) {
+		options.op = OP_MOVE_AT;
+	    } else if (std::strcmp(value, "state_at") == 0) {
+		options.op = OP_STATE_AT;
+	    } else if (std::strcmp(value, "distance") == 0) {
+		options.op = OP_DISTANCE;
+	    } else if (std::strcmp(value, "range") == 0) {
+		options.op = OP_RANGE;
+	    } else if (std::strcmp(value, "plan") == 0) {
+		options.op = OP_PLAN;
+	    } else {
+		return false;
+	    }
+	} else {
+	    return false;
+	}
+    }
+    return (argc % 2 == 0) && options.connections > 0 && options.depth > 0 && options.disks > 0;
+}
+
+int connect_to(const char* socket_path)
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path, sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+	return -1;
+    }
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+	close(fd);
+	return -1;
+    }
+    return fd;
+}
+
+// Writes as much of the output as the socket takes.
+bool flush(Client& client)
+{
+    while (client.written < client.output.size()) {
+	ssize_t count = send(client.fd, client.output.data() + client.written,
+			     client.output.size() - client.written, MSG_NOSIGNAL | MSG_DONTWAIT);
+	if (count > 0) {
+	    client.written += count;
+	} else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	    return true;
+	} else if (count < 0 && errno == EINTR) {
+	    continue;
+	} else {
+	    return false;
+	}
+    }
+    client.output.clear();
+    client.written = 0;
+    return true;
+}
+
+}  // namespace
+
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+	cerr << "Usage: " << argv[0] << " <socket> [--connections C] [--depth D] [--seconds S] [--disks N]"
+	     << " [--op move_at|state_at|distance|range|plan]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+	cerr << "Error: can not create the epoll instance: " << std::strerror(errno) << endl;
+	return EXIT_FAILURE;
+    }
+    std::vector<Client> clients(options.connections);
+    std::mt19937_64 random(42);
+    for (size_t i = 0; i < clients.size(); ++i) {
+	clients[i].fd = connect_to(options.socket_path);
+	if (clients[i].fd < 0) {
+	    cerr << "Error: can not connect to " << options.socket_path << ": " << std::strerror(errno) << endl;
+	    return EXIT_FAILURE;
+	}
+	if (options.op == OP_PLAN) {
+	    clients[i].planner = std::make_unique<Solver>(options.disks);
+	}
+	epoll_event event;
+	event.events   = EPOLLIN;
+	event.data.u64 = i;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, clients[i].fd, &event) < 0) {
+	    cerr << "Error: can not watch the connection: " << std::strerror(errno) << endl;
+	    return EXIT_FAILURE;
+	}
+
+	// Fill the pipeline.
+	for (unsigned j = 0; j < options.depth; ++j) {
+	    send_request(clients[i], options, random);
+	}
+	flush(clients[i]);
+    }
+
+    std::vector<double> latencies;
+    size_t errors = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point stop  = start + std::chrono::seconds(options.seconds);
+    epoll_event events[64];
+    char buffer[64 * 1024];
+
+    while (Clock::now() < stop) {
+	int count = epoll_wait(epoll_fd, events, 64, 100);
+	if (count < 0 && errno != EINTR) {
+	    cerr << "Error: epoll_wait: " << std::strerror(errno) << endl;
+	    return EXIT_FAILURE;
+	}
+	for (int i = 0; i < count; ++i) {
+	    Client& client = clients[events[i].data.u64];
+	    ssize_t size = recv(client.fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+	    if (size == 0 || (size < 0 && errno != EAGAIN && errno != EINTR)) {
+		cerr << "Error: the server closed the connection." << endl;
+		return EXIT_FAILURE;
+	    }
+	    if (size < 0) {
+		continue;
+	    }
+	    client.input.append(buffer, size);
+
+	    // Every complete response finishes the oldest request in flight, which is replaced by a new one.
+	    size_t offset = 0;
+	    size_t frame;
+	    Clock::time_point now = Clock::now();
+	    while ((frame = complete_frame(client.input.data() + offset, client.input.size() - offset)) != 0) {
+		if (uint8_t(client.input[offset + 8]) != STATUS_OK) {
+		    ++errors;
+		}
+		latencies.push_back(std::chrono::duration<double, std::micro>(now - client.sent.front()).count());
+		client.sent.pop_front();
+		send_request(client, options, random);
+		offset += frame;
+	    }
+	    client.input.erase(0, offset);
+	    flush(client);
+	}
+	// Keep pushing out anything the sockets did not take yet.
+	for (Client& client : clients) {
+	    if (!client.output.empty()) {
+		flush(client);
+	    }
+	}
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    for (Client& client : clients) {
+	close(client.fd);
+    }
+    close(epoll_fd);
+
+    if (latencies.empty()) {
+	cerr << "Error: no responses." << endl;
+	return EXIT_FAILURE;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[size_t(p * (latencies.size() - 1))]; };
+
+    cout << "requests " << latencies.size() << '\n'
+	 << "errors " << errors << '\n'
+	 << "seconds " << elapsed << '\n'
+	 << "qps " << latencies.size() / elapsed << '\n'
+	 << "p50_us " << percentile(0.50) << '\n'
+	 << "p99_us " << percentile(0.99) << '\n'
+	 << "p999_us " << percentile(0.999) << endl;
+    return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
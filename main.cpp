@@ -1,14 +1,707 @@
 #include "SDL.h"     // Simple DirectMedia Layer API structures and functions
-#include <cstdlib>   // for exit(), EXIT_SUCCESS, EXIT_FAILURE, NULL, std::size_t
+#include <algorithm> // for std::min, std::sort
+#include <cerrno>    // for errno
+#include <cstdio>    // for FILE, std::fprintf, std::printf, std::fscanf, std::fflush, std::fclose
+#include <cstdlib>   // for exit(), EXIT_SUCCESS, EXIT_FAILURE, NULL, std::size_t, std::strtoull
+#include <cstring>   // for std::strcmp, std::strerror
 #include <iostream>  // for std::cin, std::cout, std::cerr, std::endl;
+#include <memory>    // for std::unique_ptr
+#include <optional>  // for std::optional
+#include <stdexcept> // for std::exception, std::runtime_error
+#include <string>    // for std::string
+#include <thread>    // for std::thread::hardware_concurrency
+#include <utility>   // for std::pair
+#include <vector>    // for std::vector
+
+#include <fcntl.h>   // for open, O_WRONLY, O_CREAT, O_TRUNC
+#include <sys/stat.h>  // for fstat
+#include <unistd.h>  // for ftruncate, lseek, fsync, close
 
 using std::cin;
 using std::cout;
 using std::cerr;
 using std::endl;
+using std::string;
+using std::vector;
 
+#include "alloc_tracker.h"  // for alloc_report()
+#include "analytics.h"   // for range_stats_batch()
+#include "batch.h"       // for check_batch()
+#include "checkpoint.h"  // for Checkpointer class
+#include "dashboard.h"   // for Dashboard class
+#include "engine.h"      // for Engine class, diff_engines()
 #include "hanoi.h"   // for Hanoi class
 #include "drawer.h"  // for Drawer class
+#include "move_range.h"     // for MoveRange class
+#include "perf_counters.h"  // for PerfCounters class
+#include "server.h"  // for QueryServer class
+#include "session.h" // for Session class
+#include "shard.h"   // for ShardedGenerator class
+#include "solver.h"  // for Solver class
+#include "telemetry.h"  // for export_trace_at_exit()
+
+
+// By default a checkpoint is saved every 2^26 moves.
+// Printing that many moves takes several seconds, while saving a checkpoint takes a few milliseconds.
+#define DEFAULT_CHECKPOINT_INTERVAL (uint64_t(1) << 26)
+
+
+/**
+ * Runs the game without any graphics and prints the moves, one move per line:
+ * the index of the move, the disk, the tower it goes from and the tower it goes to (1 ... 3).
+ *
+ * Usage: --headless <disks> [<first move> [<number of moves>]]
+ *                   [--output <file>] [--checkpoint <file> [--checkpoint-every <moves>]] [--engine <name>]
+ * There is no limit on the number of disks, and the first move may be anywhere in the solution,
+ * so a window deep inside an astronomically long solution can be printed.
+ * By default the whole solution is printed to the console.
+ *
+ * With --checkpoint, the position of the solve is saved to that file every so many moves
+ * (DEFAULT_CHECKPOINT_INTERVAL by default). If the file already exists when the program starts,
+ * the solve resumes from it instead of starting over: the output file is cut back to the end of the last
+ * move before the checkpoint, so no move is lost or written twice. It does not resume if the output file is missing
+ * or shorter than that. The checkpoint file is removed once the solve finishes.
+ *
+ * With --engine, the moves come from that engine (see engine.h) instead of the Solver. The engine plays from the
+ * first move, so the moves before <first move> are made and skipped, and it can not be combined with --checkpoint.
+ *
+ * @return int - EXIT_SUCCESS, or EXIT_FAILURE if the arguments are invalid.
+ */
+int run_headless(int argc, char* argv[])
+{
+    const char* output_path     = nullptr;
+    const char* checkpoint_path = nullptr;
+    const char* engine_name     = nullptr;
+    uint64_t checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL;
+    vector<const char*> numbers;
+    bool valid = true;
+    for (int i = 2; i < argc; ++i) {
+	if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+	    output_path = argv[++i];
+	} else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+	    checkpoint_path = argv[++i];
+	} else if (std::strcmp(argv[i], "--engine") == 0 && i + 1 < argc) {
+	    engine_name = argv[++i];
+	} else if (std::strcmp(argv[i], "--checkpoint-every") == 0 && i + 1 < argc) {
+	    checkpoint_interval = std::strtoull(argv[++i], nullptr, 10);
+	    valid = valid && checkpoint_interval > 0;
+	} else if (argv[i][0] == '-') {
+	    valid = false;
+	} else {
+	    numbers.push_back(argv[i]);
+	}
+    }
+    if (!valid || numbers.empty() || numbers.size() > 3 || (engine_name != nullptr && checkpoint_path != nullptr)) {
+        cerr << "Usage: " << argv[0] << " --headless <disks> [<first move> [<number of moves>]]"
+	     << " [--output <file>] [--checkpoint <file> [--checkpoint-every <moves>] | --engine <name>]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    try {
+	MoveIndex num_disks = MoveIndex::from_string(numbers[0]);
+	if (num_disks.is_zero() || !num_disks.fits_u64()) {
+	    cerr << "Error: number of disks must be > 0." << endl;
+	    return EXIT_FAILURE;
+	}
+	Solver solver(num_disks.to_u64());
+
+	MoveIndex first = numbers.size() > 1 ? MoveIndex::from_string(numbers[1]) : MoveIndex(0);
+	if (first > solver.total_moves()) {
+	    cerr << "Error: the solution has only " << solver.total_moves().to_string() << " moves." << endl;
+	    return EXIT_FAILURE;
+	}
+	MoveIndex end = numbers.size() > 2 ? first + MoveIndex::from_string(numbers[2]) : solver.total_moves();
+	if (end > solver.total_moves()) {
+	    end = solver.total_moves();
+	}
+
+	// Resume from the checkpoint, if there is one.
+	std::optional<Checkpointer> checkpointer;
+	bool resumed = false;
+	uint64_t output_offset = 0;
+	if (checkpoint_path != nullptr) {
+	    checkpointer.emplace(checkpoint_path, checkpoint_interval);
+	    Checkpoint checkpoint;
+	    if (checkpointer->load(checkpoint)) {
+		if (checkpoint.num_disks != solver.getNumDisks()) {
+		    throw std::runtime_error("the checkpoint is for a different number of disks");
+		}
+		first = checkpoint.position;
+		end   = checkpoint.end;
+		output_offset = checkpoint.output_offset;
+		solver.seek(first);
+		if (first > end || end > solver.total_moves() || solver.getTowers() != checkpoint.towers) {
+		    throw std::runtime_error("the checkpoint does not match the solution");
+		}
+		resumed = true;
+		cerr << "Resuming from move " << first.to_string() << endl;
+	    }
+	}
+	// The engine is picked here, once, and then only asked for chunks of moves.
+	std::unique_ptr<Engine> engine;
+	if (engine_name != nullptr) {
+	    engine = make_engine(engine_name, vector<unsigned char>(solver.getNumDisks(), 0), 2);
+	    if (engine == nullptr) {
+		throw std::runtime_error(string("the ") + engine_name + " engine can not play a game of this size");
+	    }
+	    if (!end.fits_u64()) {
+		throw std::runtime_error("with --engine, the moves must end before move 2^64");
+	    }
+	} else if (!resumed) {
+	    solver.seek(first);
+	}
+
+	FILE* out = stdout;
+	if (output_path != nullptr) {
+	    // When resuming, the file must be there, and whatever was written after the checkpoint is dropped.
+	    int fd = open(output_path, O_WRONLY | O_CLOEXEC | (resumed ? 0 : O_CREAT | O_TRUNC), 0644);
+	    if (fd < 0) {
+		throw std::runtime_error(string("can not open ") + output_path + ": " + std::strerror(errno));
+	    }
+	    struct stat status;
+	    string error;
+	    if (resumed && fstat(fd, &status) < 0) {
+		error = string("can not open ") + output_path + ": " + std::strerror(errno);
+	    } else if (resumed && uint64_t(status.st_size) < output_offset) {
+		// A missing or cut off output file would be padded with zeros up to the checkpoint.
+		error = string("can not resume: ") + output_path + " is shorter than the checkpoint says";
+	    } else if ((resumed && ftruncate(fd, output_offset) < 0) || lseek(fd, 0, SEEK_END) < 0 ||
+		       (out = fdopen(fd, "w")) == nullptr) {
+		error = string("can not open ") + output_path + ": " + std::strerror(errno);
+	    }
+	    // The file is closed before giving up on it.
+	    if (!error.empty()) {
+		close(fd);
+		throw std::runtime_error(error);
+	    }
+	}
+
+	if (engine) {
+	    vector<Move> chunk(ENGINE_CHUNK);
+	    uint64_t index = 0;
+	    size_t made = 0;
+	    while (index < end.to_u64() && (made = engine->generate(chunk.data(), ENGINE_CHUNK)) != 0) {
+		for (size_t i = 0; i < made && index < end.to_u64(); ++i, ++index) {
+		    if (index >= first.to_u64()) {
+			const Move& move = chunk[i];
+			if (std::fprintf(out, "%llu %zu %d %d\n", (unsigned long long)index, move.disk, move.from + 1, move.to + 1) < 0) {
+			    throw std::runtime_error(string("can not write the moves: ") + std::strerror(errno));
+			}
+		    }
+		}
+	    }
+	}
+	for (MoveIndex left = engine ? MoveIndex(0) : end - first; !left.is_zero(); --left) {
+	    string index = solver.position().to_string();
+	    Move move = solver.next();
+	    int written = std::fprintf(out, "%s %zu %d %d\n", index.c_str(), move.disk, move.from + 1, move.to + 1);
+	    if (written < 0) {
+		throw std::runtime_error(string("can not write the moves: ") + std::strerror(errno));
+	    }
+	    output_offset += written;
+
+	    if (checkpointer && checkpointer->due()) {
+		// The moves before the checkpoint must be on the disk before the checkpoint says so.
+		// (The console can not be synced, fsync() fails on it with EINVAL.)
+		if (std::fflush(out) != 0 || (fsync(fileno(out)) < 0 && errno != EINVAL)) {
+		    throw std::runtime_error(string("can not write the moves: ") + std::strerror(errno));
+		}
+		checkpointer->save(Checkpoint{solver.getNumDisks(), solver.position(), end, output_offset, solver.getTowers()});
+	    }
+	}
+
+	if (std::fflush(out) != 0 || (out != stdout && std::fclose(out) != 0)) {
+	    throw std::runtime_error(string("can not write the moves: ") + std::strerror(errno));
+	}
+	if (checkpointer) {
+	    checkpointer->remove();
+	}
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * Measures the hardware performance counters of the move loop of each engine, without any graphics,
+ * and prints one line of JSON per engine (see perf_summary_json()).
+ *
+ * Usage: --profile <disks> [hanoi|solver|range|all]
+ * The engines are:
+ *   hanoi  - Hanoi::stream(), the moves of the game without the drawing: the move tables up to
+ *            MAX_TABLE_DISKS disks, and the Towers with add_one() above that.
+ *   solver - Solver::next().
+ *   range  - MoveRange, which computes each move from its index (up to 64 disks).
+ * Build with make profile to also get the cycles of every Tower::push_disk() and Tower::pop_disk().
+ *
+ * @return int - EXIT_SUCCESS, or EXIT_FAILURE if the arguments are invalid.
+ */
+int run_profile(int argc, char* argv[])
+{
+    string engine = argc > 3 ? argv[3] : "all";
+    size_t num_disks = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+    if (argc < 3 || argc > 4 || num_disks == 0 || num_disks > 63 ||
+        (engine != "hanoi" && engine != "solver" && engine != "range" && engine != "all")) {
+        cerr << "Usage: " << argv[0] << " --profile <disks [1 ... 63]> [hanoi|solver|range|all]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    PerfCounters counters;
+    // Every move is folded into sink, so that the compiler can not throw the loops away.
+    volatile size_t sink = 0;
+
+    if (engine == "hanoi" || engine == "all") {
+	// Setting up the Towers is not part of the measurement.
+	Hanoi game(num_disks);
+	Generator<Move> moves = game.stream();
+	uint64_t count = 0;
+	size_t disks = 0;
+	reset_profile_sites();
+	counters.start();
+	while (moves.next()) {
+	    disks += moves.value().disk;
+	    ++count;
+	}
+	PerfSample sample = counters.stop();
+	sink = sink + disks;
+	cout << perf_summary_json("hanoi", num_disks, count, sample) << endl;
+    }
+
+    if (engine == "solver" || engine == "all") {
+	Solver solver(num_disks);
+	uint64_t count = 0;
+	size_t disks = 0;
+	reset_profile_sites();
+	counters.start();
+	while (!solver.done()) {
+	    disks += solver.next().disk;
+	    ++count;
+	}
+	PerfSample sample = counters.stop();
+	sink = sink + disks;
+	cout << perf_summary_json("solver", num_disks, count, sample) << endl;
+    }
+
+    if (engine == "range" || engine == "all") {
+	MoveRange range(num_disks);
+	uint64_t count = 0;
+	size_t disks = 0;
+	reset_profile_sites();
+	counters.start();
+	for (Move move : range) {
+	    disks += move.disk;
+	    ++count;
+	}
+	PerfSample sample = counters.stop();
+	sink = sink + disks;
+	cout << perf_summary_json("range", num_disks, count, sample) << endl;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * Plays the game without any graphics in a build with allocation tracking (make check-allocs),
+ * and prints how many allocations were made while setting the game up and while solving it (see alloc_tracker.h).
+ * Once the game is set up, making the moves should not allocate anything at all.
+ *
+ * Usage: --alloc-report <disks>
+ *
+ * @return int - EXIT_SUCCESS, or EXIT_FAILURE if the arguments are invalid,
+ *               the program was built without -DHANOI_TRACK_ALLOCS, or solving allocated memory.
+ */
+int run_alloc_report(int argc, char* argv[])
+{
+    size_t num_disks = argc == 3 ? std::strtoull(argv[2], nullptr, 10) : 0;
+    if (num_disks == 0 || num_disks > 63) {
+        cerr << "Usage: " << argv[0] << " --alloc-report <disks [1 ... 63]>" << endl;
+	return EXIT_FAILURE;
+    }
+    if (!alloc_tracking_enabled()) {
+        cerr << "Error: built without allocation tracking, use make check-allocs." << endl;
+	return EXIT_FAILURE;
+    }
+
+    reset_alloc_stats();
+    uint64_t count = 0;
+    {
+	ALLOC_PHASE(PHASE_SETUP);
+	Hanoi game(num_disks);
+	Generator<Move> moves = game.stream();
+
+	ALLOC_PHASE(PHASE_SOLVE);
+	while (moves.next()) {
+	    ++count;
+	}
+    }
+
+    AllocStats solve = alloc_stats(PHASE_SOLVE);
+    cout << "disks " << num_disks << " moves " << count << '\n' << alloc_report(count) << std::flush;
+    if (solve.allocations != 0) {
+        cerr << "Error: solving made " << solve.allocations << " allocations." << endl;
+	return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * Writes the whole solution of a large game into a file, split into shards which are generated
+ * by several worker processes (see class ShardedGenerator). Each move is a 4-byte record (see shard.h).
+ *
+ * Usage: --sharded <disks> <file> [--workers <processes>] [--shards <shards>]
+ * By default there is one worker per CPU and four shards per worker.
+ * If some shards fail, running the same command again generates only those.
+ *
+ * @return int - EXIT_SUCCESS if every shard is done, EXIT_FAILURE otherwise.
+ */
+int run_sharded(int argc, char* argv[])
+{
+    unsigned num_workers = std::thread::hardware_concurrency();
+    num_workers = num_workers == 0 ? 1 : num_workers;
+    size_t num_shards = 0;
+    bool valid = argc >= 4 && argc % 2 == 0;
+    for (int i = 4; valid && i + 1 < argc; i += 2) {
+	if (std::strcmp(argv[i], "--workers") == 0) {
+	    num_workers = std::strtoul(argv[i + 1], nullptr, 10);
+	    valid = num_workers > 0;
+	} else if (std::strcmp(argv[i], "--shards") == 0) {
+	    num_shards = std::strtoull(argv[i + 1], nullptr, 10);
+	    valid = num_shards > 0;
+	} else {
+	    valid = false;
+	}
+    }
+    size_t num_disks = valid ? std::strtoull(argv[2], nullptr, 10) : 0;
+    if (num_disks == 0 || num_disks > MAX_SHARD_DISKS) {
+        cerr << "Usage: " << argv[0] << " --sharded <disks [1 ... " << MAX_SHARD_DISKS << "]> <file>"
+	     << " [--workers <processes>] [--shards <shards>]" << endl;
+	return EXIT_FAILURE;
+    }
+    if (num_shards == 0) {
+	uint64_t total_moves = (uint64_t(1) << num_disks) - 1;
+	num_shards = std::min<uint64_t>({uint64_t(num_workers) * 4, MAX_SHARDS, total_moves});
+    }
+
+    try {
+	ShardedGenerator generator(argv[3], num_disks, num_shards);
+	if (!generator.run(num_workers)) {
+	    cerr << "Error: some shards failed, run the same command again to retry them." << endl;
+	    return EXIT_FAILURE;
+	}
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * Checks the solver engines against the reference engine (see diff_engines()) and prints every mismatch.
+ *
+ * Usage: --diff [--disks <largest number of disks>] [--scrambled <start states>] [--threads <threads>]
+ *               [--engines <name>,<name>,...]
+ * By default all the engines are checked on 1 ... 20 disks, with 8 scrambled start states per number of disks,
+ * on one thread per CPU. That goes past MAX_TABLE_DISKS, above which Hanoi::stream() stops playing back the move table
+ * and runs its own binary counter and Towers.
+ *
+ * @return int - EXIT_SUCCESS if every engine matches the reference, EXIT_FAILURE otherwise.
+ */
+int run_diff(int argc, char* argv[])
+{
+    size_t max_disks = 20;
+    size_t num_scrambled = 8;
+    unsigned num_threads = std::thread::hardware_concurrency();
+    num_threads = num_threads == 0 ? 1 : num_threads;
+    vector<string> engines(engine_names().begin() + 1, engine_names().end());
+    bool valid = argc % 2 == 0;
+    for (int i = 2; valid && i + 1 < argc; i += 2) {
+	if (std::strcmp(argv[i], "--disks") == 0) {
+	    max_disks = std::strtoull(argv[i + 1], nullptr, 10);
+	    valid = max_disks > 0 && max_disks <= 40;
+	} else if (std::strcmp(argv[i], "--scrambled") == 0) {
+	    num_scrambled = std::strtoull(argv[i + 1], nullptr, 10);
+	} else if (std::strcmp(argv[i], "--threads") == 0) {
+	    num_threads = std::strtoul(argv[i + 1], nullptr, 10);
+	    valid = num_threads > 0;
+	} else if (std::strcmp(argv[i], "--engines") == 0) {
+	    engines.clear();
+	    string list = argv[i + 1];
+	    for (size_t begin = 0, end; begin <= list.size(); begin = end + 1) {
+		end = list.find(',', begin);
+		end = end == string::npos ? list.size() : end;
+		engines.push_back(list.substr(begin, end - begin));
+	    }
+	} else {
+	    valid = false;
+	}
+    }
+    if (!valid) {
+        cerr << "Usage: " << argv[0] << " --diff [--disks <largest number of disks [1 ... 40]>] [--scrambled <start states>]"
+	     << " [--threads <threads>] [--engines <name>,<name>,...]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    try {
+	DiffReport report = diff_engines(engines, max_disks, num_scrambled, num_threads);
+	for (const string& mismatch : report.mismatches) {
+	    cerr << "Mismatch: " << mismatch << endl;
+	}
+	cout << "games " << report.games << " runs " << report.runs << " moves " << report.moves
+	     << " mismatches " << report.mismatches.size() << endl;
+	return report.mismatches.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	return EXIT_FAILURE;
+    }
+}
+
+
+/**
+ * Prints the statistics of ranges of moves of the standard solution (see range_stats()), one line of JSON per range.
+ *
+ * Usage: --analytics <disks> <first move> <end move> [<first move> <end move> ...]
+ *
+ * @return int - EXIT_SUCCESS, or EXIT_FAILURE if the arguments are invalid.
+ */
+int run_analytics(int argc, char* argv[])
+{
+    if (argc < 5 || argc % 2 == 0) {
+        cerr << "Usage: " << argv[0] << " --analytics <disks [1 ... " << MAX_ANALYTICS_DISKS
+	     << "]> <first move> <end move> [<first move> <end move> ...]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    try {
+	size_t num_disks = std::strtoull(argv[2], nullptr, 10);
+	vector<std::pair<uint64_t, uint64_t>> ranges;
+	for (int i = 3; i + 1 < argc; i += 2) {
+	    ranges.emplace_back(std::strtoull(argv[i], nullptr, 10), std::strtoull(argv[i + 1], nullptr, 10));
+	}
+	for (const RangeStats& stats : range_stats_batch(num_disks, ranges)) {
+	    cout << range_stats_json(stats) << '\n';
+	}
+	cout << std::flush;
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+/**
+ * Checks the BatchSolver (see check_batch()): solves a batch of random puzzles of every kind on a pool of threads,
+ * checks the moves of every puzzle, and prints every mismatch.
+ *
+ * Usage: --batch [--puzzles <puzzles>] [--disks <largest number of disks>] [--threads <threads>] [--split <moves>]
+ * By default 96 puzzles of 1 ... 14 disks are solved on one thread per CPU, split into pieces of 1024 moves.
+ *
+ * @return int - EXIT_SUCCESS if every puzzle was solved correctly, EXIT_FAILURE otherwise.
+ */
+int run_batch(int argc, char* argv[])
+{
+    size_t num_puzzles = 96;
+    size_t max_disks = 14;
+    size_t num_threads = 0;
+    uint64_t split_moves = 1024;
+    bool valid = argc % 2 == 0;
+    for (int i = 2; valid && i + 1 < argc; i += 2) {
+	if (std::strcmp(argv[i], "--puzzles") == 0) {
+	    num_puzzles = std::strtoull(argv[i + 1], nullptr, 10);
+	} else if (std::strcmp(argv[i], "--disks") == 0) {
+	    max_disks = std::strtoull(argv[i + 1], nullptr, 10);
+	    valid = max_disks > 0 && max_disks <= 20;
+	} else if (std::strcmp(argv[i], "--threads") == 0) {
+	    num_threads = std::strtoull(argv[i + 1], nullptr, 10);
+	    valid = num_threads > 0;
+	} else if (std::strcmp(argv[i], "--split") == 0) {
+	    split_moves = std::strtoull(argv[i + 1], nullptr, 10);
+	    valid = split_moves > 0;
+	} else {
+	    valid = false;
+	}
+    }
+    if (!valid) {
+        cerr << "Usage: " << argv[0] << " --batch [--puzzles <puzzles>] [--disks <largest number of disks [1 ... 20]>]"
+	     << " [--threads <threads>] [--split <moves>]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    try {
+	BatchReport report = check_batch(num_puzzles, max_disks, num_threads, split_moves);
+	for (const string& mismatch : report.mismatches) {
+	    cerr << "Mismatch: " << mismatch << endl;
+	}
+	cout << "puzzles " << report.puzzles << " moves " << report.moves
+	     << " mismatches " << report.mismatches.size() << endl;
+	return report.mismatches.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	return EXIT_FAILURE;
+    }
+}
+
+
+/**
+ * Runs the query server (see class QueryServer) until the process gets SIGINT or SIGTERM.
+ *
+ * Usage: --serve <socket path>
+ *
+ * @return int - EXIT_SUCCESS, or EXIT_FAILURE if the socket can not be set up.
+ */
+int run_server(int argc, char* argv[])
+{
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " --serve <socket path>" << endl;
+	return EXIT_FAILURE;
+    }
+
+    try {
+	QueryServer server(argv[2]);
+	server.run();
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+
+// A replay fails the regression check if its median frame is this much slower than the baseline.
+#define REPLAY_TOLERANCE 1.25
+
+
+/**
+ * Replays a recorded session (see class Session) without a window and as fast as the software renderer can draw,
+ * and prints the number of frames, the move it ended on, and the mean, median and 99th percentile of the frame times.
+ *
+ * Usage: --replay <trace> [--frames <frames>] [--position <moves>] [--baseline <file>] [--save-baseline <file>]
+ * --frames and --position are what the replay has to draw: the number of frames and the move it ends on.
+ * They do not depend on the machine, so they can be checked anywhere.
+ * --save-baseline writes the frame times of this replay to a file. --baseline compares this replay with such a file,
+ * and fails if the replay has a different number of frames or its median frame is more than REPLAY_TOLERANCE times slower.
+ * Frame times are only comparable on the same machine, so a baseline should be saved where it is used.
+ *
+ * @return int - EXIT_SUCCESS, or EXIT_FAILURE if the arguments are invalid,
+ *               the replay does not match the recording, or it is slower than the baseline.
+ */
+int run_replay(int argc, char* argv[])
+{
+    const char* baseline_path = nullptr;
+    const char* save_path     = nullptr;
+    const char* frames_arg    = nullptr;
+    const char* position_arg  = nullptr;
+    bool valid = argc >= 3 && argc % 2 == 1;
+    for (int i = 3; valid && i + 1 < argc; i += 2) {
+	if (std::strcmp(argv[i], "--frames") == 0) {
+	    frames_arg = argv[i + 1];
+	} else if (std::strcmp(argv[i], "--position") == 0) {
+	    position_arg = argv[i + 1];
+	} else if (std::strcmp(argv[i], "--baseline") == 0) {
+	    baseline_path = argv[i + 1];
+	} else if (std::strcmp(argv[i], "--save-baseline") == 0) {
+	    save_path = argv[i + 1];
+	} else {
+	    valid = false;
+	}
+    }
+    if (!valid) {
+        cerr << "Usage: " << argv[0] << " --replay <trace> [--frames <frames>] [--position <moves>]"
+	     << " [--baseline <file>] [--save-baseline <file>]" << endl;
+	return EXIT_FAILURE;
+    }
+
+    if (SDL_Init(0) != 0) {
+        cerr << "Error: Initialization of SDL failed: " << SDL_GetError() << endl;
+	return EXIT_FAILURE;
+    }
+    // The frames are drawn into a surface in memory, the same size as the window.
+    SDL_Surface* surface   = SDL_CreateRGBSurfaceWithFormat(0, 640, 480, 32, SDL_PIXELFORMAT_RGBA8888);
+    SDL_Renderer* renderer = surface ? SDL_CreateSoftwareRenderer(surface) : nullptr;
+    if (!renderer) {
+        cerr << "Error: Creating the software renderer failed: " << SDL_GetError() << endl;
+	SDL_FreeSurface(surface);
+	SDL_Quit();
+	return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    try {
+	SessionReader reader(argv[2]);
+	Session session(reader.getNumDisks());
+	vector<uint64_t> frames;
+	{
+	    Drawer draw(nullptr, renderer, reader.getNumDisks());
+	    frames = session.replay(&draw, reader);
+	}
+
+	vector<uint64_t> sorted = frames;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0;
+	for (uint64_t frame : sorted) {
+	    total += frame;
+	}
+	uint64_t p50 = sorted.empty() ? 0 : sorted[(sorted.size() - 1) / 2];
+	uint64_t p99 = sorted.empty() ? 0 : sorted[size_t(0.99 * (sorted.size() - 1))];
+	std::printf("frames %zu position %llu mean_us %.1f p50_us %.1f p99_us %.1f\n", frames.size(),
+		    (unsigned long long)session.getPosition(), sorted.empty() ? 0.0 : total / sorted.size() / 1000.0,
+		    p50 / 1000.0, p99 / 1000.0);
+
+	if (frames_arg != nullptr && std::strtoull(frames_arg, nullptr, 10) != frames.size()) {
+	    cerr << "Error: the replay has " << frames.size() << " frames, expected " << frames_arg << "." << endl;
+	    status = EXIT_FAILURE;
+	}
+	if (position_arg != nullptr && std::strtoull(position_arg, nullptr, 10) != session.getPosition()) {
+	    cerr << "Error: the replay ended on move " << session.getPosition() << ", expected " << position_arg << "." << endl;
+	    status = EXIT_FAILURE;
+	}
+
+	if (save_path != nullptr) {
+	    FILE* out = std::fopen(save_path, "w");
+	    if (out == nullptr || std::fprintf(out, "frames %zu p50_ns %llu\n", frames.size(), (unsigned long long)p50) < 0 ||
+		std::fclose(out) != 0) {
+		throw std::runtime_error(string("can not write ") + save_path);
+	    }
+	}
+	if (baseline_path != nullptr) {
+	    FILE* in = std::fopen(baseline_path, "r");
+	    size_t baseline_frames = 0;
+	    unsigned long long baseline_p50 = 0;
+	    if (in == nullptr || std::fscanf(in, "frames %zu p50_ns %llu", &baseline_frames, &baseline_p50) != 2) {
+		if (in != nullptr) {
+		    std::fclose(in);
+		}
+		throw std::runtime_error(string("can not read the baseline ") + baseline_path);
+	    }
+	    std::fclose(in);
+	    if (baseline_frames != frames.size()) {
+		cerr << "Error: the baseline has " << baseline_frames << " frames, the replay has " << frames.size() << "." << endl;
+		status = EXIT_FAILURE;
+	    } else if (p50 > baseline_p50 * REPLAY_TOLERANCE) {
+		cerr << "Error: the median frame took " << p50 / 1000.0 << " us, the baseline " << baseline_p50 / 1000.0
+		     << " us." << endl;
+		status = EXIT_FAILURE;
+	    }
+	}
+    } catch (const std::exception& e) {
+        cerr << "Error: " << e.what() << endl;
+	status = EXIT_FAILURE;
+    }
+
+    SDL_DestroyRenderer(renderer);
+    SDL_FreeSurface(surface);
+    SDL_Quit();
+    return status;
+}
 
 
 // The preprocessor directive is used if we want to mix C and C++ code together.
@@ -18,20 +711,75 @@ using std::endl;
 #ifdef __cplusplus
     extern "C"
 #endif
-int main()
+int main(int argc, char* argv[])
 {
+    // The headless mode does not need the SDL subsystems at all.
+    if (argc > 1 && std::strcmp(argv[1], "--headless") == 0) {
+	return run_headless(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--serve") == 0) {
+	return run_server(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--profile") == 0) {
+	return run_profile(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--alloc-report") == 0) {
+	return run_alloc_report(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--sharded") == 0) {
+	return run_sharded(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--diff") == 0) {
+	return run_diff(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--batch") == 0) {
+	return run_batch(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--analytics") == 0) {
+	return run_analytics(argc, argv);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--replay") == 0) {
+	return run_replay(argc, argv);
+    }
+
+    // --trace <file> plays the game as usual, and when the program exits writes a Chrome trace of the frames
+    // to the file and a summary of the frame times to the console (see telemetry.h).
+    // --record <file> records the session, so it can be replayed later with --replay (see class Session).
+    const char* record_path = nullptr;
+    bool dashboard = argc > 1 && std::strcmp(argv[1], "--dashboard") == 0;
+    for (int i = 1; !dashboard && i < argc; i += 2) {
+	if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+	    export_trace_at_exit(argv[i + 1]);
+	} else if (std::strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+	    record_path = argv[i + 1];
+	} else {
+	    cerr << "Usage: " << argv[0] << " [--trace <file>] [--record <file>]" << endl;
+	    return EXIT_FAILURE;
+	}
+    }
+
+    // --dashboard [<puzzles>] shows many puzzles side by side instead of a single game (see class Dashboard).
+    size_t number_of_puzzles = 0;
+    if (dashboard) {
+	number_of_puzzles = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 24;
+	if (argc > 3 || number_of_puzzles == 0 || number_of_puzzles > MAX_DASHBOARD_PUZZLES) {
+	    cerr << "Usage: " << argv[0] << " --dashboard [<puzzles [1 ... " << MAX_DASHBOARD_PUZZLES << "]>]" << endl;
+	    return EXIT_FAILURE;
+	}
+    }
+
     // Initialization to 0 removes garbage values.
     // In case the cin statement fails,
     // the value in number_of_disks will be invalid, that value will be rejected, and the user prompted for input once again.
     size_t number_of_disks = 0;
-    while (true) {
-        cout << "Enter the number of disks [1 ... 10]\n > ";
+    while (number_of_puzzles == 0) {
+        cout << "Enter the number of disks [1 ... " << MAX_SESSION_DISKS << "]\n > ";
         cin  >> number_of_disks;
 
 	if (number_of_disks == 0) {
 	    cerr << "Error: number of disks must be > 0." << endl;
-	} else if (number_of_disks > 10) {
-	    cerr << "Error: number of disks must be <= 10." << endl;
+	} else if (number_of_disks > MAX_SESSION_DISKS) {
+	    cerr << "Error: number of disks must be <= " << MAX_SESSION_DISKS << "." << endl;
 	} else {
 	    break;
 	}
@@ -59,7 +807,12 @@ int main()
     }
 
     /* Allocate dynamic memory for the SDL_Renderer and check for errors. */
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    // The frames of the animation are paced by the display (vsync), and the scene is cached in a texture.
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC | SDL_RENDERER_TARGETTEXTURE);
+    // Without a graphics card, fall back to the software renderer.
+    if (!renderer) {
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE | SDL_RENDERER_TARGETTEXTURE);
+    }
     // If creating renderer failed, SDL_CreateRenderer() returns a null pointer.
     if (!renderer) {
         cerr << "Error: Creating renderer failed: " << SDL_GetError() << endl;
@@ -71,14 +824,40 @@ int main()
 	exit(EXIT_FAILURE);
     }
 
-    // Initialize the Towers of Hanoi.
-    Hanoi game1(number_of_disks);
+    if (number_of_puzzles != 0) {
+	Drawer draw(window, renderer, 1);
+	Dashboard dashboard(number_of_puzzles);
+	dashboard.play(&draw);
+
+	SDL_DestroyWindow(window);
+	SDL_DestroyRenderer(renderer);
+	SDL_Quit();
+	return EXIT_SUCCESS;
+    }
+
+    // Everything up to the first move counts as setting up (see alloc_tracker.h).
+    reset_alloc_stats();
+    set_alloc_phase(PHASE_SETUP);
+
+    // Initialize the Towers of Hanoi, and the recording if there is one.
+    Session session(number_of_disks);
+    std::optional<SessionWriter> writer;
+    if (record_path != nullptr) {
+	try {
+	    writer.emplace(record_path, number_of_disks);
+	} catch (const std::exception& e) {
+	    cerr << "Error: " << e.what() << endl;
+	}
+    }
     // Initialize the Drawer.
     Drawer draw(window, renderer, number_of_disks);
-    // Draw the initial state of the Tower of Hanoi.
-    draw.draw_Hanoi(game1);
-    // Play the game, drawing each move.
-    game1.play(&draw);
+    // Play the game, drawing each frame. The user can pause it with space, change the speed with + and -,
+    // and jump back and forward with the arrow keys.
+    session.play(&draw, writer ? &*writer : nullptr);
+
+    if (alloc_tracking_enabled()) {
+	cerr << alloc_report((uint64_t(1) << number_of_disks) - 1);
+    }
 
 
     /* This chunk of code is responsible for safely exiting the program. */
@@ -0,0 +1,29 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <cstdlib>   // for std::size_t
+
+using std::size_t;
+
+// Represents a single move of the game: the disk named disk goes from the Tower from to the Tower to.
+// The towers are numbered from 0 (the leftmost tower, tower1) to 2 (the rightmost tower, tower3).
+struct Move {
+    // The number of the disk (ex. 0, 1, 2, ...)
+    size_t disk;
+    // The tower where the disk is popped from.
+    int from;
+    // The tower where the disk is pushed onto.
+    int to;
+};
+
+inline bool operator==(const Move& a, const Move& b)
+{
+    return a.disk == b.disk && a.from == b.from && a.to == b.to;
+}
+
+inline bool operator!=(const Move& a, const Move& b)
+{
+    return !(a == b);
+}
+
+#endif /* MOVE_H */
@@ -0,0 +1,279 @@
+#include "move_index.h"
+
+#include <algorithm>  // for std::reverse
+#include <stdexcept>  // for std::invalid_argument
+
+
+MoveIndex::MoveIndex(uint64_t value)
+{
+    if (value != 0) {
+	words.push_back(value);
+    }
+}
+
+
+MoveIndex MoveIndex::power_of_two(size_t power)
+{
+    MoveIndex result;
+    result.words.resize(power / 64 + 1, 0);
+    result.words.back() = uint64_t(1) << (power % 64);
+    return result;
+}
+
+
+MoveIndex MoveIndex::from_string(const string& text)
+{
+    if (text.empty()) {
+	throw std::invalid_argument("MoveIndex: empty number");
+    }
+
+    MoveIndex result;
+    for (char c : text) {
+	if (c < '0' || c > '9') {
+	    throw std::invalid_argument("MoveIndex: not a decimal number: " + text);
+	}
+	// result = result * 10 + digit, one word at a time.
+	uint64_t carry = c - '0';
+	for (uint64_t& word : result.words) {
+	    unsigned __int128 product = (unsigned __int128)word * 10 + carry;
+	    word  = (uint64_t)product;
+	    carry = (uint64_t)(product >> 64);
+	}
+	if (carry != 0) {
+	    result.words.push_back(carry);
+	}
+    }
+    return result;
+}
+
+
+string MoveIndex::to_string() const
+{
+    if (is_zero()) {
+	return "0";
+    }
+
+    // Peel off 19 decimal digits at a time, the most that fit into a uint64_t.
+    const uint64_t chunk = 10000000000000000000ULL;
+    MoveIndex temp = *this;
+    string digits;
+    while (!temp.is_zero()) {
+	uint64_t part = temp.divide(chunk);
+	for (int i = 0; i < 19; ++i) {
+	    digits += char('0' + part % 10);
+	    part /= 10;
+	    if (temp.is_zero() && part == 0) {
+		break;
+	    }
+	}
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+
+void MoveIndex::set_bit(size_t i, bool value)
+{
+    size_t word = i / 64;
+    if (word >= words.size()) {
+	if (!value) {
+	    return;
+	}
+	words.resize(word + 1, 0);
+    }
+
+    if (value) {
+	words[word] |= uint64_t(1) << (i % 64);
+    } else {
+	words[word] &= ~(uint64_t(1) << (i % 64));
+	trim();
+    }
+}
+
+
+size_t MoveIndex::bit_length() const
+{
+    if (is_zero()) {
+	return 0;
+    }
+    return words.size() * 64 - __builtin_clzll(words.back());
+}
+
+
+size_t MoveIndex::trailing_zeros() const
+{
+    size_t i = 0;
+    // The number has no zero words at the top, so a non-zero word is always found.
+    while (i < words.size() && words[i] == 0) {
+	++i;
+    }
+    if (i == words.size()) {
+	return 0;
+    }
+    return i * 64 + __builtin_ctzll(words[i]);
+}
+
+
+uint64_t MoveIndex::divide(uint64_t divisor)
+{
+    unsigned __int128 rest = 0;
+    // Long division, starting from the most significant word.
+    for (size_t i = words.size(); i-- > 0;) {
+	unsigned __int128 current = (rest << 64) | words[i];
+	words[i] = (uint64_t)(current / divisor);
+	rest     = current % divisor;
+    }
+    trim();
+    return (uint64_t)rest;
+}
+
+
+uint64_t MoveIndex::remainder(uint64_t divisor) const
+{
+    unsigned __int128 rest = 0;
+    for (size_t i = words.size(); i-- > 0;) {
+	rest = ((rest << 64) | words[i]) % divisor;
+    }
+    return (uint64_t)rest;
+}
+
+
+MoveIndex MoveIndex::from_words(const vector<uint64_t>& words)
+{
+    MoveIndex result;
+    result.words = words;
+    result.trim();
+    return result;
+}
+
+
+MoveIndex& MoveIndex::operator++()
+{
+    // Works the same way as Hanoi::add_one(), only with 64 bits at a time.
+    // Every word which is all 1s rolls over to 0, the carry goes on to the next word.
+    for (uint64_t& word : words) {
+	if (++word != 0) {
+	    return *this;
+	}
+    }
+    // All the words rolled over, the number gets one word longer.
+    words.push_back(1);
+    return *this;
+}
+
+
+MoveIndex& MoveIndex::operator--()
+{
+    // Every word which is 0 rolls under to all 1s, the borrow goes on to the next word.
+    for (uint64_t& word : words) {
+	if (word-- != 0) {
+	    break;
+	}
+    }
+    trim();
+    return *this;
+}
+
+
+MoveIndex& MoveIndex::operator+=(const MoveIndex& other)
+{
+    if (words.size() < other.words.size()) {
+	words.resize(other.words.size(), 0);
+    }
+
+    uint64_t carry = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+	uint64_t addend = i < other.words.size() ? other.words[i] : 0;
+	if (addend == 0 && carry == 0 && i >= other.words.size()) {
+	    break;
+	}
+	unsigned __int128 sum = (unsigned __int128)words[i] + addend + carry;
+	words[i] = (uint64_t)sum;
+	carry    = (uint64_t)(sum >> 64);
+    }
+    if (carry != 0) {
+	words.push_back(carry);
+    }
+    return *this;
+}
+
+
+MoveIndex& MoveIndex::operator-=(const MoveIndex& other)
+{
+    uint64_t borrow = 0;
+    for (size_t i = 0; i < words.size(); ++i) {
+	uint64_t subtrahend = i < other.words.size() ? other.words[i] : 0;
+	if (subtrahend == 0 && borrow == 0 && i >= other.words.size()) {
+	    break;
+	}
+	uint64_t result = words[i] - subtrahend - borrow;
+	borrow   = (words[i] < subtrahend || (words[i] == subtrahend && borrow)) ? 1 : 0;
+	words[i] = result;
+    }
+    trim();
+    return *this;
+}
+
+
+MoveIndex& MoveIndex::operator<<=(size_t shift)
+{
+    if (is_zero() || shift == 0) {
+	return *this;
+    }
+
+    size_t word_shift = shift / 64;
+    unsigned bit_shift = shift % 64;
+
+    words.resize(words.size() + word_shift + 1, 0);
+    for (size_t i = words.size(); i-- > 0;) {
+	uint64_t high = i >= word_shift ? words[i - word_shift] : 0;
+	uint64_t low  = i >= word_shift + 1 ? words[i - word_shift - 1] : 0;
+	words[i] = bit_shift == 0 ? high : (high << bit_shift) | (low >> (64 - bit_shift));
+    }
+    trim();
+    return *this;
+}
+
+
+MoveIndex& MoveIndex::operator>>=(size_t shift)
+{
+    size_t word_shift = shift / 64;
+    unsigned bit_shift = shift % 64;
+
+    if (word_shift >= words.size()) {
+	words.clear();
+	return *this;
+    }
+
+    size_t new_size = words.size() - word_shift;
+    for (size_t i = 0; i < new_size; ++i) {
+	uint64_t low  = words[i + word_shift];
+	uint64_t high = i + word_shift + 1 < words.size() ? words[i + word_shift + 1] : 0;
+	words[i] = bit_shift == 0 ? low : (low >> bit_shift) | (high << (64 - bit_shift));
+    }
+    words.resize(new_size);
+    trim();
+    return *this;
+}
+
+
+int MoveIndex::compare(const MoveIndex& a, const MoveIndex& b)
+{
+    if (a.words.size() != b.words.size()) {
+	return a.words.size() < b.words.size() ? -1 : 1;
+    }
+    for (size_t i = a.words.size(); i-- > 0;) {
+	if (a.words[i] != b.words[i]) {
+	    return a.words[i] < b.words[i] ? -1 : 1;
+	}
+    }
+    return 0;
+}
+
+
+void MoveIndex::trim()
+{
+    while (!words.empty() && words.back() == 0) {
+	words.pop_back();
+    }
+}
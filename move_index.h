@@ -0,0 +1,163 @@
+#ifndef MOVE_INDEX_H
+#define MOVE_INDEX_H
+
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::vector;
+
+/**
+ * An arbitrary-precision unsigned integer used to number the moves of a solution.
+ *
+ * A game with N disks needs 2^N - 1 moves, so the index of a move needs N bits.
+ * For N > 64 it no longer fits into a size_t, therefore the bits are stored in a vector of
+ * 64-bit words, the least significant word first.
+ * The vector never has zero words at the end (most significant side), so the number 0 is an empty vector.
+ *
+ * Only the operations needed by the solvers are provided.
+ * Most of them take O(number of words) time, except operator++ and operator--,
+ * which take amortized O(1) time, just like Hanoi::add_one().
+ */
+class MoveIndex {
+  public:
+    // A default constructed MoveIndex is 0.
+    MoveIndex() {}
+
+    // Allows us to write MoveIndex(42) or pass a plain number wherever a MoveIndex is expected.
+    MoveIndex(uint64_t value);
+
+    /**
+     * @param size_t power - The exponent.
+     * @return MoveIndex - 2^power
+     */
+    static MoveIndex power_of_two(size_t power);
+
+    /**
+     * Parses a non-negative decimal number, such as the one written by to_string().
+     * Throws std::invalid_argument if the text is empty or has anything other than the digits 0-9.
+     *
+     * @param const string& text - The decimal digits.
+     */
+    static MoveIndex from_string(const string& text);
+
+    /**
+     * @return string - The number written in decimal.
+     */
+    string to_string() const;
+
+    /**
+     * @return bool - true if the number is 0.
+     */
+    inline bool is_zero() const { return words.empty(); }
+
+    /**
+     * @return bool - true if the number fits into a single uint64_t, so to_u64() can be called.
+     */
+    inline bool fits_u64() const { return words.size() <= 1; }
+
+    /**
+     * @return uint64_t - The value of the number, if fits_u64() is true.
+     *                    Otherwise only the lowest 64 bits are returned.
+     */
+    inline uint64_t to_u64() const { return words.empty() ? 0 : words[0]; }
+
+    /**
+     * @param size_t i - The position of the bit, 0 is the 2^0 bit.
+     * @return bool - The value of that bit.
+     */
+    inline bool bit(size_t i) const
+    {
+	size_t word = i / 64;
+	return word < words.size() && ((words[word] >> (i % 64)) & 1);
+    }
+
+    /**
+     * Sets or clears a single bit.
+     *
+     * @param size_t i   - The position of the bit, 0 is the 2^0 bit.
+     * @param bool value - The new value of that bit.
+     */
+    void set_bit(size_t i, bool value);
+
+    /**
+     * @return size_t - The number of bits needed to write the number, 0 for the number 0.
+     */
+    size_t bit_length() const;
+
+    /**
+     * @return size_t - The number of 0 bits below the lowest 1 bit.
+     *                  This is the name of the disk moved by the move number *this - 1.
+     *   For the number 0, 0 is returned.
+     */
+    size_t trailing_zeros() const;
+
+    /**
+     * Divides the number by a small divisor in place.
+     *
+     * @param uint64_t divisor - Must be > 0.
+     * @return uint64_t - The remainder.
+     */
+    uint64_t divide(uint64_t divisor);
+
+    /**
+     * @param uint64_t divisor - Must be > 0.
+     * @return uint64_t - The remainder of the number divided by the divisor. The number is not changed.
+     */
+    uint64_t remainder(uint64_t divisor) const;
+
+    /**
+     * @return const vector<uint64_t>& - The words of the number, the least significant word first.
+     *                                   Used to write the number in binary form.
+     */
+    inline const vector<uint64_t>& get_words() const { return words; }
+
+    /**
+     * Builds a number out of its words, the least significant word first.
+     * Zero words at the end are allowed and removed.
+     */
+    static MoveIndex from_words(const vector<uint64_t>& words);
+
+    // Adding or subtracting 1 rolls over a run of bits, just like Hanoi::add_one().
+    // Each of them takes amortized O(1) time.
+    MoveIndex& operator++();
+    // Subtracting 1 from 0 is not allowed.
+    MoveIndex& operator--();
+
+    MoveIndex& operator+=(const MoveIndex& other);
+    // Subtracting a larger number is not allowed.
+    MoveIndex& operator-=(const MoveIndex& other);
+    MoveIndex& operator<<=(size_t shift);
+    MoveIndex& operator>>=(size_t shift);
+
+    friend MoveIndex operator+(MoveIndex a, const MoveIndex& b) { return a += b; }
+    friend MoveIndex operator-(MoveIndex a, const MoveIndex& b) { return a -= b; }
+    friend MoveIndex operator<<(MoveIndex a, size_t shift) { return a <<= shift; }
+    friend MoveIndex operator>>(MoveIndex a, size_t shift) { return a >>= shift; }
+
+    /**
+     * @return int - negative if a < b, 0 if a == b, positive if a > b.
+     */
+    static int compare(const MoveIndex& a, const MoveIndex& b);
+
+    friend bool operator==(const MoveIndex& a, const MoveIndex& b) { return a.words == b.words; }
+    friend bool operator!=(const MoveIndex& a, const MoveIndex& b) { return a.words != b.words; }
+    friend bool operator<(const MoveIndex& a, const MoveIndex& b)  { return compare(a, b) < 0; }
+    friend bool operator>(const MoveIndex& a, const MoveIndex& b)  { return compare(a, b) > 0; }
+    friend bool operator<=(const MoveIndex& a, const MoveIndex& b) { return compare(a, b) <= 0; }
+    friend bool operator>=(const MoveIndex& a, const MoveIndex& b) { return compare(a, b) >= 0; }
+
+  private:
+    // Removes the zero words at the most significant end.
+    void trim();
+
+    // The bits of the number, 64 at a time.
+    // words[0] holds the bits 2^0 ... 2^63, words[1] holds the bits 2^64 ... 2^127, etc, etc...
+    vector<uint64_t> words;
+};
+
+#endif /* MOVE_INDEX_H */
@@ -0,0 +1,164 @@
+#ifndef MOVE_RANGE_H
+#define MOVE_RANGE_H
+
+#include "move.h"
+
+#include <cstddef>   // for std::ptrdiff_t
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <iterator>  // for std::random_access_iterator_tag
+#include <stdexcept> // for std::invalid_argument
+
+using std::ptrdiff_t;
+using std::size_t;
+using std::uint64_t;
+
+/**
+ * A random access iterator over the moves of the solution.
+ *
+ * It holds nothing but the index of the move and the description of the game, so it never allocates,
+ * and each move is computed from its index in O(1) time:
+ * the move number k moves the disk d which is the lowest 1 bit of k + 1 (just like Hanoi::add_one()),
+ * and before that disk d has been moved (k + 1) >> (d + 1) times, always in the same direction around the towers.
+ *
+ * Since the index is a uint64_t, it supports games with up to 64 disks.
+ * Larger games must use the Solver class, which has arbitrary-precision move indices.
+ */
+class MoveIterator {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef Move value_type;
+    typedef ptrdiff_t difference_type;
+    typedef const Move* pointer;
+    // The moves are computed on the fly, so they are returned by value.
+    typedef Move reference;
+
+    MoveIterator() : index{0}, num_disks{0}, source{0}, largest_step{0} {}
+
+    /**
+     * @param uint64_t index       - The index of the move this iterator points to.
+     * @param size_t num_disks     - The number of disks in the game, <= 64.
+     * @param int source           - The tower where all the disks start.
+     * @param int largest_step     - 1 if the largest disk goes one tower to the right from source to the target,
+     *                               2 if it goes two towers to the right.
+     */
+    MoveIterator(uint64_t index, size_t num_disks, int source, int largest_step)
+	: index{index}, num_disks{num_disks}, source{source}, largest_step{largest_step} {}
+
+    inline Move operator*() const
+    {
+	uint64_t counter = index + 1;
+	size_t disk = __builtin_ctzll(counter);
+	// The number of times the disk moved before. For disk 63 it is always 0, and shifting by 64 is not allowed.
+	uint64_t times = disk < 63 ? counter >> (disk + 1) : 0;
+	// Every next smaller disk goes the other way around the towers.
+	int step = (num_disks - 1 - disk) % 2 == 0 ? largest_step : 3 - largest_step;
+	int from = (source + step * int(times % 3)) % 3;
+	return Move{disk, from, (from + step) % 3};
+    }
+
+    inline Move operator[](difference_type n) const { return *(*this + n); }
+
+    inline MoveIterator& operator++() { ++index; return *this; }
+    inline MoveIterator& operator--() { --index; return *this; }
+    inline MoveIterator operator++(int) { MoveIterator old = *this; ++index; return old; }
+    inline MoveIterator operator--(int) { MoveIterator old = *this; --index; return old; }
+    inline MoveIterator& operator+=(difference_type n) { index += n; return *this; }
+    inline MoveIterator& operator-=(difference_type n) { index -= n; return *this; }
+
+    friend MoveIterator operator+(MoveIterator it, difference_type n) { return it += n; }
+    friend MoveIterator operator+(difference_type n, MoveIterator it) { return it += n; }
+    friend MoveIterator operator-(MoveIterator it, difference_type n) { return it -= n; }
+    friend difference_type operator-(const MoveIterator& a, const MoveIterator& b) { return difference_type(a.index - b.index); }
+
+    friend bool operator==(const MoveIterator& a, const MoveIterator& b) { return a.index == b.index; }
+    friend bool operator!=(const MoveIterator& a, const MoveIterator& b) { return a.index != b.index; }
+    friend bool operator<(const MoveIterator& a, const MoveIterator& b)  { return a.index < b.index; }
+    friend bool operator>(const MoveIterator& a, const MoveIterator& b)  { return a.index > b.index; }
+    friend bool operator<=(const MoveIterator& a, const MoveIterator& b) { return a.index <= b.index; }
+    friend bool operator>=(const MoveIterator& a, const MoveIterator& b) { return a.index >= b.index; }
+
+    /**
+     * @return uint64_t - The index of the move this iterator points to.
+     */
+    inline uint64_t getIndex() const { return index; }
+
+  private:
+    uint64_t index;
+    size_t num_disks;
+    int source;
+    int largest_step;
+};
+
+/**
+ * The moves of the solution (or a part of it) as a range, to be used in a range-based for loop
+ * or with the standard algorithms:
+ *
+ *     for (Move move : MoveRange(5)) { ... }
+ *     std::count_if(range.begin(), range.end(), [](Move m) { return m.disk == 0; });
+ *
+ * Like MoveIterator, it supports games with up to 64 disks.
+ */
+class MoveRange {
+  public:
+    /**
+     * The whole solution, all the moves 0 ... 2^num_disks - 2.
+     * Throws std::invalid_argument if the number of disks is not 1 ... 64.
+     *
+     * @param size_t num_disks - The number of disks in the game, 1 ... 64.
+     * @param int source       - The tower where all the disks start, 0 ... 2.
+     * @param int target       - The tower where all the disks end up, 0 ... 2, != source.
+     */
+    MoveRange(size_t num_disks, int source = 0, int target = 2)
+	: MoveRange(window(num_disks, 0, ~uint64_t(0) >> (64 - check_num_disks(num_disks)), source, target)) {}
+
+    /**
+     * A part of the solution, the moves first ... last - 1.
+     * It is a named function rather than a constructor, so that window(n, 100, 200) can never be mistaken for
+     * MoveRange(n, source, target).
+     * Throws std::invalid_argument if the number of disks is not 1 ... 64.
+     *
+     * @param size_t num_disks - The number of disks in the game, 1 ... 64.
+     * @param uint64_t first   - The index of the first move.
+     * @param uint64_t last    - The index one past the last move, <= 2^num_disks - 1.
+     * @param int source       - The tower where all the disks start, 0 ... 2.
+     * @param int target       - The tower where all the disks end up, 0 ... 2, != source.
+     */
+    static MoveRange window(size_t num_disks, uint64_t first, uint64_t last, int source = 0, int target = 2)
+    {
+	check_num_disks(num_disks);
+	int largest_step = (target - source + 3) % 3;
+	return MoveRange(MoveIterator(first, num_disks, source, largest_step), MoveIterator(last, num_disks, source, largest_step));
+    }
+
+    inline MoveIterator begin() const { return first; }
+    inline MoveIterator end() const { return last; }
+
+    /**
+     * @return uint64_t - The number of moves in the range.
+     */
+    inline uint64_t size() const { return last.getIndex() - first.getIndex(); }
+
+    inline bool empty() const { return first == last; }
+
+    inline Move operator[](uint64_t i) const { return *(first + difference_type(i)); }
+
+  private:
+    // Returns num_disks, or throws if a MoveIterator can not count the moves of a game that size.
+    static size_t check_num_disks(size_t num_disks)
+    {
+	if (num_disks == 0 || num_disks > 64) {
+	    throw std::invalid_argument("MoveRange: the number of disks must be 1 ... 64");
+	}
+	return num_disks;
+    }
+
+    typedef MoveIterator::difference_type difference_type;
+
+    MoveRange(const MoveIterator& first, const MoveIterator& last) : first{first}, last{last} {}
+
+    MoveIterator first;
+    MoveIterator last;
+};
+
+#endif /* MOVE_RANGE_H */
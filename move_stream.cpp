@@ -0,0 +1,120 @@
+#include "move_stream.h"
+#include "solver.h"
+
+#include <cstdint>  // for std::uint64_t
+
+using std::uint64_t;
+
+
+Generator<Move> stream_moves(size_t num_disks, int source, int target)
+{
+    Solver solver(num_disks, source, target);
+    while (!solver.done()) {
+	co_yield solver.next();
+    }
+}
+
+
+Generator<Move> stream_moves_from(vector<unsigned char> start, int target)
+{
+    // A disk which has to move, together with the towers of its move.
+    // The disks smaller than it have to be gathered on the spare tower before it moves,
+    // and then they follow it onto its target tower.
+    struct Step {
+	size_t disk;
+	int from;
+	int to;
+	int spare;
+    };
+
+    // Walk the disks from the largest one down.
+    // A disk which is already where it has to be never moves, and the disks below it have the same goal.
+    // A disk which is not there moves once, so the disks smaller than it first have to go to its spare tower,
+    // which becomes their goal.
+    vector<Step> steps;
+    int goal = target;
+    for (size_t i = start.size() - 1; i != ~size_t(0); --i) {
+	if (start[i] != goal) {
+	    int spare = 3 - start[i] - goal;
+	    steps.push_back(Step{i, start[i], goal, spare});
+	    goal = spare;
+	}
+    }
+
+    // The steps are made from the smallest disk up.
+    // Before each step all the disks smaller than step.disk are gathered on step.spare.
+    for (size_t j = steps.size() - 1; j != ~size_t(0); --j) {
+	const Step& step = steps[j];
+	co_yield Move{step.disk, step.from, step.to};
+
+	Solver solver(step.disk, step.spare, step.to);
+	while (!solver.done()) {
+	    co_yield solver.next();
+	}
+    }
+}
+
+
+Generator<Move> stream_moves_towers(size_t num_disks, int num_towers, int source, int target)
+{
+    // best_split[t - 3][m] is the best k for m disks and t towers.
+    // cost[m] is the number of moves needed for m disks with the current number of towers,
+    // which is a long double because it gets astronomically large.
+    vector<vector<size_t>> best_split(num_towers - 2, vector<size_t>(num_disks + 1, 0));
+    vector<long double> cost(num_disks + 1, 0);
+
+    // With 3 towers all but the largest disk go to the spare tower: 2^m - 1 moves.
+    for (size_t m = 1; m <= num_disks; ++m) {
+	cost[m] = 2 * cost[m - 1] + 1;
+	best_split[0][m] = m - 1;
+    }
+
+    // With t towers, k disks move twice using t towers, and m - k disks move once using t - 1 towers.
+    // The best k never decreases as m grows, so it is found by moving k forward while it gets better.
+    for (int t = 4; t <= num_towers; ++t) {
+	vector<long double> fewer_towers = cost;
+	size_t k = 0;
+	for (size_t m = 1; m <= num_disks; ++m) {
+	    while (k + 1 < m && 2 * cost[k + 1] + fewer_towers[m - k - 1] <= 2 * cost[k] + fewer_towers[m - k]) {
+		++k;
+	    }
+	    cost[m] = 2 * cost[k] + fewer_towers[m - k];
+	    best_split[t - 3][m] = k;
+	}
+    }
+
+    // The recursion of the Frame-Stewart algorithm is kept on an explicit stack of smaller games.
+    // Each of them moves count disks, starting with the disk named smallest, using only the towers in the towers bit mask.
+    struct Game {
+	size_t count;
+	size_t smallest;
+	int from;
+	int to;
+	uint64_t towers;
+    };
+
+    uint64_t all_towers = num_towers == 64 ? ~uint64_t(0) : (uint64_t(1) << num_towers) - 1;
+    vector<Game> games;
+    games.push_back(Game{num_disks, 0, source, target, all_towers});
+    while (!games.empty()) {
+	Game game = games.back();
+	games.pop_back();
+
+	if (game.count == 0) {
+	    continue;
+	}
+	if (game.count == 1) {
+	    co_yield Move{game.smallest, game.from, game.to};
+	    continue;
+	}
+
+	size_t k = best_split[__builtin_popcountll(game.towers) - 3][game.count];
+	uint64_t spare_towers = game.towers & ~(uint64_t(1) << game.from) & ~(uint64_t(1) << game.to);
+	int spare = __builtin_ctzll(spare_towers);
+
+	// Pushed in the reverse order, since the last one pushed is played first.
+	games.push_back(Game{k, game.smallest, spare, game.to, game.towers});
+	games.push_back(Game{game.count - k, game.smallest + k, game.from, game.to, game.towers & ~(uint64_t(1) << spare)});
+	games.push_back(Game{k, game.smallest, game.from, spare, game.towers});
+    }
+}
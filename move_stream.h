@@ -0,0 +1,55 @@
+#ifndef MOVE_STREAM_H
+#define MOVE_STREAM_H
+
+#include "generator.h"
+#include "move.h"
+
+#include <cstdlib>   // for std::size_t
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::vector;
+
+/*
+ * Lazy move streams. Each function returns a Generator which computes the next move only when
+ * the consumer pulls it, so the consumer decides the pace, and nothing is stored except O(num_disks) state.
+ */
+
+/**
+ * The standard game: all the disks go from the source tower to the target tower, 2^num_disks - 1 moves.
+ * Works for any number of disks (see class Solver).
+ *
+ * @param size_t num_disks - The number of disks in the game.
+ * @param int source       - The tower where all the disks start, 0 ... 2.
+ * @param int target       - The tower where all the disks end up, 0 ... 2, != source.
+ */
+Generator<Move> stream_moves(size_t num_disks, int source = 0, int target = 2);
+
+/**
+ * The game which starts from any legal arrangement of the disks (the smaller disks always on top of the larger ones),
+ * and ends with all the disks on the target tower, using the fewest possible moves.
+ *
+ * The largest disk which is not on the target tower moves there once, right after the disks smaller than it
+ * have been gathered on the third tower; then they follow it in the standard way.
+ *
+ * @param vector<unsigned char> start - start[i] is the tower (0 ... 2) where disk i starts.
+ * @param int target                  - The tower where all the disks end up, 0 ... 2.
+ */
+Generator<Move> stream_moves_from(vector<unsigned char> start, int target);
+
+/**
+ * The game with more than three towers (pegs): all the disks go from the source tower to the target tower,
+ * using the Frame-Stewart algorithm:
+ * the k smallest disks go to a spare tower using all the towers, the rest of the disks go to the target tower
+ * without touching that spare tower, and then the k smallest disks follow them using all the towers again.
+ * The best k for each number of disks and towers is computed once when the stream starts,
+ * in O(num_disks * num_towers) time and memory.
+ *
+ * @param size_t num_disks - The number of disks in the game.
+ * @param int num_towers   - The number of towers, 3 ... 64.
+ * @param int source       - The tower where all the disks start, 0 ... num_towers - 1.
+ * @param int target       - The tower where all the disks end up, 0 ... num_towers - 1, != source.
+ */
+Generator<Move> stream_moves_towers(size_t num_disks, int num_towers, int source, int target);
+
+#endif /* MOVE_STREAM_H */
@@ -0,0 +1,27 @@
+#include "move_table.h"
+
+#include <utility>  // for std::index_sequence, std::make_index_sequence
+
+
+namespace {
+
+// Builds { nullptr, MoveTable<1>::moves.data(), ..., MoveTable<MAX_TABLE_DISKS>::moves.data() },
+// so that tables[n] is the table for n disks.
+template<size_t... I>
+constexpr std::array<const PackedMove*, sizeof...(I) + 1> make_tables(std::index_sequence<I...>)
+{
+    return {{ nullptr, MoveTable<I + 1>::moves.data()... }};
+}
+
+constexpr std::array<const PackedMove*, MAX_TABLE_DISKS + 1> tables = make_tables(std::make_index_sequence<MAX_TABLE_DISKS>());
+
+}  // namespace
+
+
+const PackedMove* move_table(size_t num_disks)
+{
+    if (num_disks > MAX_TABLE_DISKS) {
+	return nullptr;
+    }
+    return tables[num_disks];
+}
@@ -0,0 +1,88 @@
+#ifndef MOVE_TABLE_H
+#define MOVE_TABLE_H
+
+#include "move.h"
+
+#include <array>     // for std::array
+#include <cstdint>   // for std::uint8_t
+#include <cstdlib>   // for std::size_t
+
+using std::size_t;
+using std::uint8_t;
+
+/**
+ * For a small number of disks the whole solution fits into a small table,
+ * which the compiler builds once at compile time.
+ * Playing such a game back is then just a walk through the table, with no computation at all.
+ *
+ * Each move is packed into a single byte:
+ * bits 0-3 hold the disk, bits 4-5 hold the tower it goes from, bits 6-7 hold the tower it goes to.
+ * 4 bits for the disk are enough for up to 16 disks.
+ * The tables move all the disks from tower 0 (tower1) to tower 2 (tower3).
+ */
+typedef uint8_t PackedMove;
+
+// The largest number of disks which has a table.
+// The table for 16 disks has 65535 moves, 64 KB.
+#define MAX_TABLE_DISKS 16
+
+inline constexpr PackedMove pack_move(size_t disk, int from, int to)
+{
+    return PackedMove(disk | (from << 4) | (to << 6));
+}
+
+inline constexpr Move unpack_move(PackedMove packed)
+{
+    return Move{size_t(packed & 0x0F), (packed >> 4) & 0x03, (packed >> 6) & 0x03};
+}
+
+/**
+ * The table of all the moves of the game with N disks, built at compile time.
+ * Use it like this:
+ *     for (PackedMove move : MoveTable<5>::moves) { ... unpack_move(move) ... }
+ */
+template<size_t N>
+struct MoveTable {
+    static_assert(N >= 1 && N <= MAX_TABLE_DISKS, "MoveTable: N must be 1 ... MAX_TABLE_DISKS");
+
+    // 2^N - 1 moves.
+    static constexpr size_t size = (size_t(1) << N) - 1;
+
+    /**
+     * Runs the same binary counter as Hanoi::add_one() and Solver::next() at compile time.
+     */
+    static constexpr std::array<PackedMove, size> build()
+    {
+	std::array<PackedMove, size> table{};
+	// towers[i] is the tower of disk i. All the disks start on tower 0.
+	int towers[N] = {};
+	for (size_t k = 1; k <= size; ++k) {
+	    // The disk which moves is the lowest 1 bit of k.
+	    size_t disk = 0;
+	    while (((k >> disk) & 1) == 0) {
+		++disk;
+	    }
+	    // The largest disk goes 2 towers to the right (from tower 0 to tower 2),
+	    // every next smaller disk goes the other way around.
+	    int step = (N - 1 - disk) % 2 == 0 ? 2 : 1;
+	    int from = towers[disk];
+	    int to   = (from + step) % 3;
+	    towers[disk] = to;
+	    table[k - 1] = pack_move(disk, from, to);
+	}
+	return table;
+    }
+
+    static constexpr std::array<PackedMove, size> moves = build();
+};
+
+/**
+ * Picks the table for a number of disks known only at runtime.
+ *
+ * @param size_t num_disks - The number of disks in the game.
+ * @return const PackedMove* - The first move of the table for num_disks disks, which has 2^num_disks - 1 moves.
+ *    nullptr is returned if num_disks is 0 or > MAX_TABLE_DISKS, there is no such table.
+ */
+const PackedMove* move_table(size_t num_disks);
+
+#endif /* MOVE_TABLE_H */
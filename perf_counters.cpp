@@ -0,0 +1,154 @@
+#include "perf_counters.h"
+
+#include <cstring>    // for std::memset
+#include <sstream>    // for std::ostringstream
+
+#include <linux/perf_event.h>  // for perf_event_attr, PERF_TYPE_HARDWARE, ...
+#include <sys/ioctl.h>         // for ioctl
+#include <sys/syscall.h>       // for SYS_perf_event_open
+#include <unistd.h>            // for syscall, read, close
+
+
+ProfileSite profile_tower_push = {"tower_push", 0, 0};
+ProfileSite profile_tower_pop  = {"tower_pop", 0, 0};
+
+
+namespace {
+
+// Opens one counter of the calling thread, on any CPU, disabled, user space only.
+// Reading it also gives the time it was enabled and the time it was really counting (see PerfCounters::stop()).
+// Returns -1 if it is not available.
+int open_event(uint32_t type, uint64_t config)
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = type;
+    attr.config         = config;
+    attr.disabled       = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return fd < 0 ? -1 : int(fd);
+}
+
+// The name of each event in the JSON summary, "per move" except for the branch misses, which are a rate.
+const char* const EVENT_NAMES[NUM_PERF_EVENTS] = {
+    "cycles_per_move",
+    "instructions_per_move",
+    "branches_per_move",
+    "branch_miss_rate",
+    "l1d_misses_per_move",
+    "llc_misses_per_move"
+};
+
+}  // namespace
+
+
+PerfCounters::PerfCounters() : start_cycles{0}
+{
+    const uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D |
+				   (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+				   (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    fds[PERF_CYCLES]        = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    fds[PERF_INSTRUCTIONS]  = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    fds[PERF_BRANCHES]      = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS);
+    fds[PERF_BRANCH_MISSES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    fds[PERF_L1D_MISSES]    = open_event(PERF_TYPE_HW_CACHE, l1d_read_miss);
+    fds[PERF_LLC_MISSES]    = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+}
+
+
+PerfCounters::~PerfCounters()
+{
+    for (int fd : fds) {
+	if (fd >= 0) {
+	    close(fd);
+	}
+    }
+}
+
+
+void PerfCounters::start()
+{
+    for (int fd : fds) {
+	if (fd >= 0) {
+	    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+	}
+    }
+    start_cycles = read_cycles();
+}
+
+
+PerfSample PerfCounters::stop()
+{
+    uint64_t stop_cycles = read_cycles();
+    PerfSample sample;
+    for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+	if (fds[e] >= 0) {
+	    ioctl(fds[e], PERF_EVENT_IOC_DISABLE, 0);
+	    // The count, the time enabled and the time running.
+	    uint64_t values[3];
+	    if (read(fds[e], values, sizeof(values)) == sizeof(values) && values[2] != 0) {
+		// With more events than hardware counters, the kernel takes turns with them, and each one counts
+		// only part of the time. Its count is scaled up to the whole time, so the ratios stay comparable.
+		sample.counts[e]    = values[2] == values[1] ? values[0] : uint64_t(double(values[0]) * values[1] / values[2]);
+		sample.available[e] = true;
+		sample.multiplexed  = sample.multiplexed || values[2] != values[1];
+	    }
+	}
+    }
+    if (!sample.available[PERF_CYCLES]) {
+	sample.counts[PERF_CYCLES]    = stop_cycles - start_cycles;
+	sample.available[PERF_CYCLES] = true;
+	sample.rdtsc_fallback         = true;
+    }
+    return sample;
+}
+
+
+void reset_profile_sites()
+{
+    profile_tower_push.calls  = 0;
+    profile_tower_push.cycles = 0;
+    profile_tower_pop.calls   = 0;
+    profile_tower_pop.cycles  = 0;
+}
+
+
+string perf_summary_json(const string& engine, uint64_t num_disks, uint64_t moves, const PerfSample& sample)
+{
+    std::ostringstream json;
+    json << "{\"engine\":\"" << engine << "\",\"disks\":" << num_disks << ",\"moves\":" << moves
+	 << ",\"cycle_source\":\"" << (sample.rdtsc_fallback ? "rdtsc" : "perf") << '"'
+	 << ",\"multiplexed\":" << (sample.multiplexed ? "true" : "false");
+
+    double per_move = moves == 0 ? 0.0 : 1.0 / moves;
+    for (int e = 0; e < NUM_PERF_EVENTS; ++e) {
+	json << ",\"" << EVENT_NAMES[e] << "\":";
+	if (!sample.available[e]) {
+	    json << "null";
+	} else if (e == PERF_BRANCH_MISSES) {
+	    // Branch misses per branch, if the branches were counted.
+	    if (sample.available[PERF_BRANCHES] && sample.counts[PERF_BRANCHES] != 0) {
+		json << double(sample.counts[e]) / sample.counts[PERF_BRANCHES];
+	    } else {
+		json << "null";
+	    }
+	} else {
+	    json << sample.counts[e] * per_move;
+	}
+    }
+
+#ifdef HANOI_PROFILE
+    for (const ProfileSite* site : {&profile_tower_push, &profile_tower_pop}) {
+	json << ",\"" << site->name << "_calls\":" << site->calls
+	     << ",\"" << site->name << "_cycles_per_call\":" << (site->calls == 0 ? 0.0 : double(site->cycles) / site->calls);
+    }
+#endif
+
+    json << '}';
+    return json.str();
+}
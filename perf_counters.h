@@ -0,0 +1,145 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <chrono>    // for std::chrono::steady_clock
+#include <cstdint>   // for std::uint64_t
+#include <string>    // for std::string
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  // for __rdtsc
+#endif
+
+using std::string;
+using std::uint64_t;
+
+/**
+ * @return uint64_t - A cheap timestamp: the time stamp counter of the CPU on x86,
+ *                    the steady clock in nanoseconds anywhere else.
+ */
+inline uint64_t read_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// The events counted by PerfCounters.
+enum PerfEvent {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_BRANCHES,
+    PERF_BRANCH_MISSES,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    NUM_PERF_EVENTS
+};
+
+// The counts of one measurement.
+struct PerfSample {
+    uint64_t counts[NUM_PERF_EVENTS] = {};
+    // available[e] is false if event e could not be counted on this machine.
+    bool available[NUM_PERF_EVENTS] = {};
+    // true if the cycles come from the time stamp counter instead of the hardware counters.
+    bool rdtsc_fallback = false;
+    // true if some events only counted part of the time and their counts were scaled up (see PerfCounters::stop()).
+    bool multiplexed = false;
+};
+
+/**
+ * Counts hardware events (cycles, instructions, branch misses, cache misses) of the calling thread
+ * between start() and stop(), using perf_event_open.
+ *
+ * Each event is opened on its own, so an event which the CPU or the kernel does not support
+ * (or a kernel which does not allow perf_event_open at all) only makes that event unavailable.
+ * If the cycles can not be counted, the time stamp counter (see read_cycles()) is used instead.
+ * When there are fewer hardware counters than events, the kernel takes turns with them;
+ * each count is then scaled by the time its event was enabled over the time it was really counting.
+ * An event which never got a counter is unavailable.
+ */
+class PerfCounters {
+  public:
+    PerfCounters();
+    ~PerfCounters();
+
+    // I forbid you to copy or assign PerfCounters, they own the file descriptors.
+    PerfCounters(const PerfCounters& other) = delete;
+    PerfCounters& operator=(const PerfCounters& other) = delete;
+
+    /**
+     * Resets and starts all the counters.
+     */
+    void start();
+
+    /**
+     * Stops all the counters.
+     *
+     * @return PerfSample - The counts since start(), scaled up if the events had to share the counters.
+     */
+    PerfSample stop();
+
+  private:
+    // The file descriptor of each event, -1 if it is not available.
+    int fds[NUM_PERF_EVENTS];
+    // The time stamp counter at start(), used when the cycles are not available.
+    uint64_t start_cycles;
+};
+
+/*
+ * Profiling hooks for the hot functions, such as Tower::push_disk() and Tower::pop_disk().
+ *
+ * When the program is built with -DHANOI_PROFILE (make profile), PROFILE_SCOPE(site) measures
+ * the time stamp counter cycles from that point to the end of the enclosing block, and adds them to the site.
+ * Otherwise PROFILE_SCOPE(site) is nothing at all, so the normal build pays nothing.
+ * The sites are not thread-safe, they are meant for the single-threaded game.
+ */
+struct ProfileSite {
+    const char* name;
+    uint64_t calls;
+    uint64_t cycles;
+};
+
+extern ProfileSite profile_tower_push;
+extern ProfileSite profile_tower_pop;
+
+class ProfileScope {
+  public:
+    explicit ProfileScope(ProfileSite& site) : site(site), begin{read_cycles()} {}
+    ~ProfileScope()
+    {
+	site.cycles += read_cycles() - begin;
+	++site.calls;
+    }
+
+  private:
+    ProfileSite& site;
+    uint64_t begin;
+};
+
+#ifdef HANOI_PROFILE
+#define PROFILE_SCOPE(site) ProfileScope profile_scope_##site(site)
+#else
+#define PROFILE_SCOPE(site)
+#endif
+
+/**
+ * Zeroes all the profile sites.
+ */
+void reset_profile_sites();
+
+/**
+ * Writes a measurement as a single line of JSON, for example:
+ * {"engine":"solver","disks":20,"moves":1048575,"cycle_source":"perf","multiplexed":false,"cycles_per_move":5.1,...}
+ * Counts which are not available are written as null.
+ * The Tower::push_disk() and Tower::pop_disk() sites are included when the program is built with -DHANOI_PROFILE.
+ *
+ * @param const string& engine   - The name of the engine which was measured.
+ * @param uint64_t num_disks     - The number of disks.
+ * @param uint64_t moves         - The number of moves made while measuring.
+ * @param const PerfSample& sample - The counts.
+ * @return string - The line of JSON, without the newline.
+ */
+string perf_summary_json(const string& engine, uint64_t num_disks, uint64_t moves, const PerfSample& sample);
+
+#endif /* PERF_COUNTERS_H */
@@ -0,0 +1,118 @@
+#include "plan_cache.h"
+#include "move_stream.h"
+#include "state.h"
+#include "zobrist.h"
+
+#include <algorithm>  // for std::min, std::equal
+#include <stdexcept>  // for std::invalid_argument
+
+
+PlanCache::PlanCache(size_t capacity)
+    : stripe_capacity{capacity / PLAN_CACHE_STRIPES}, hits{0}, misses{0}, evictions{0}
+{
+}
+
+
+PlanCache::Stripe& PlanCache::stripe_of(const PlanKey& key)
+{
+    // The low bits of the hash pick the bucket inside the stripe, so the stripe is picked by the high bits.
+    return stripes[(key.hash >> 60) % PLAN_CACHE_STRIPES];
+}
+
+
+std::shared_ptr<const Plan> PlanCache::find(const PlanKey& key, const unsigned char* state)
+{
+    Stripe& stripe = stripe_of(key);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto it = stripe.index.find(key);
+    if (it == stripe.index.end() || !std::equal(state, state + key.num_disks, it->second->second->state.begin())) {
+	misses.fetch_add(1, std::memory_order_relaxed);
+	return nullptr;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    // Move it to the front of the order, without allocating a new node.
+    stripe.lru.splice(stripe.lru.begin(), stripe.lru, it->second);
+    return it->second->second;
+}
+
+
+void PlanCache::insert(const PlanKey& key, std::shared_ptr<const Plan> plan)
+{
+    Stripe& stripe = stripe_of(key);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    size_t bytes = plan_bytes(*plan);
+    if (stripe.index.count(key) != 0 || bytes > stripe_capacity) {
+	return;
+    }
+    while (stripe.bytes + bytes > stripe_capacity) {
+	stripe.bytes -= plan_bytes(*stripe.lru.back().second);
+	stripe.index.erase(stripe.lru.back().first);
+	stripe.lru.pop_back();
+	evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    stripe.lru.emplace_front(key, std::move(plan));
+    stripe.index.emplace(key, stripe.lru.begin());
+    stripe.bytes += bytes;
+}
+
+
+std::shared_ptr<const Plan> PlanCache::plan(const unsigned char* state, size_t num_disks, int target, uint64_t hash)
+{
+    PlanKey key{hash, num_disks, target};
+    std::shared_ptr<const Plan> found = find(key, state);
+    if (found != nullptr) {
+	return found;
+    }
+
+    for (size_t disk = 0; disk < num_disks; ++disk) {
+	if (state[disk] > 2) {
+	    throw std::invalid_argument("invalid state");
+	}
+    }
+    if (zobrist_hash(state, num_disks) != hash) {
+	throw std::invalid_argument("the hash does not match the state");
+    }
+
+    // The plan is computed outside of the lock. Two threads which miss the same state at the same time
+    // both compute it, and the first one to insert it wins.
+    auto computed = std::make_shared<Plan>();
+    computed->state.assign(state, state + num_disks);
+    computed->distance = moves_to_tower(computed->state, num_disks, target);
+    // Only as much room as the moves need, since the cache is bounded by the bytes of its plans.
+    computed->moves.reserve(computed->distance.fits_u64() ? std::min<uint64_t>(computed->distance.to_u64(), MAX_PLAN_MOVES)
+							  : MAX_PLAN_MOVES);
+    for (const Move& move : stream_moves_from(computed->state, target)) {
+	if (computed->moves.size() == MAX_PLAN_MOVES) {
+	    break;
+	}
+	computed->moves.push_back(move);
+    }
+    insert(key, computed);
+    return computed;
+}
+
+
+std::shared_ptr<const Plan> PlanCache::plan(const vector<unsigned char>& state, int target)
+{
+    return plan(state.data(), state.size(), target, zobrist_hash(state));
+}
+
+
+PlanCacheStats PlanCache::stats() const
+{
+    uint64_t entries = 0;
+    uint64_t bytes = 0;
+    for (const Stripe& stripe : stripes) {
+	std::lock_guard<std::mutex> lock(stripe.mutex);
+	entries += stripe.lru.size();
+	bytes += stripe.bytes;
+    }
+    return PlanCacheStats{hits.load(), misses.load(), evictions.load(), entries, bytes};
+}
+
+
+size_t PlanCache::plan_bytes(const Plan& plan)
+{
+    return PLAN_ENTRY_BYTES + plan.state.capacity() + plan.moves.capacity() * sizeof(Move) +
+	   plan.distance.get_words().capacity() * sizeof(uint64_t);
+}
@@ -0,0 +1,157 @@
+#ifndef PLAN_CACHE_H
+#define PLAN_CACHE_H
+
+#include "move.h"
+#include "move_index.h"
+
+#include <atomic>         // for std::atomic
+#include <cstdint>        // for std::uint64_t
+#include <cstdlib>        // for std::size_t
+#include <list>           // for std::list
+#include <memory>         // for std::shared_ptr
+#include <mutex>          // for std::mutex
+#include <unordered_map>  // for std::unordered_map
+#include <utility>        // for std::pair
+#include <vector>         // for std::vector
+
+using std::size_t;
+using std::uint64_t;
+using std::vector;
+
+// The number of independently locked parts of a PlanCache.
+#define PLAN_CACHE_STRIPES 16
+// A plan keeps at most this many of its first moves. The rest can be streamed on from where they end.
+#define MAX_PLAN_MOVES 1024
+// What keeping one plan costs on top of its moves and its distance: the Plan, the nodes of the list and of the index.
+#define PLAN_ENTRY_BYTES 184
+
+// The optimal continuation from one state of the game to all the disks on one tower.
+struct Plan {
+    // The state the plan starts from. Different states may share a hash, so a hit is only a hit if this matches.
+    vector<unsigned char> state;
+    // The number of moves of the whole continuation (see moves_to_tower()).
+    MoveIndex distance;
+    // The first moves of the continuation, at most MAX_PLAN_MOVES of them.
+    vector<Move> moves;
+};
+
+// What a plan is looked up by. The hash is the Zobrist hash of the state it starts from (see zobrist.h).
+struct PlanKey {
+    uint64_t hash;
+    size_t num_disks;
+    int target;
+
+    friend bool operator==(const PlanKey& a, const PlanKey& b)
+    {
+	return a.hash == b.hash && a.num_disks == b.num_disks && a.target == b.target;
+    }
+};
+
+struct PlanCacheStats {
+    // A lookup which finds a plan of another state with the same hash counts as a miss.
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t entries;
+    // The memory which the plans in the cache take now (see PlanCache::plan_bytes()).
+    uint64_t bytes;
+};
+
+/**
+ * A bounded cache of plans, which many threads can use at the same time.
+ *
+ * The cache is bounded by the memory its plans take rather than by their number, since the plan of a large game
+ * is much bigger than the plan of a small one: its distance alone has a bit per disk.
+ * The cache is split into PLAN_CACHE_STRIPES stripes by the hash of the key, and each stripe has its own lock,
+ * its own share of the capacity and its own least recently used order, so threads looking up different states
+ * rarely wait for each other. The plans are shared and never change once they are in the cache,
+ * so a hit hands out the plan itself without copying or allocating anything.
+ *
+ * A plan is found by the hash of its state, so a caller which keeps the hash of its game up to date
+ * (see Hanoi::getHash(), Solver::getHash()) does not hash the state again. The hash alone is not trusted, though:
+ * the keys are no secret and XOR is linear, so anyone can make up two states with the same hash.
+ * Every hit compares the state of the plan with the state asked about, and a plan of another state is a miss.
+ */
+class PlanCache {
+  public:
+    /**
+     * @param size_t capacity - The largest number of bytes the plans may take.
+     *                          Each stripe keeps capacity / PLAN_CACHE_STRIPES bytes of them.
+     *                          A plan which is larger than that on its own is handed out, but not kept.
+     */
+    PlanCache(size_t capacity);
+
+    // I forbid you to copy or assign a PlanCache, it owns the locks.
+    PlanCache(const PlanCache& other) = delete;
+    PlanCache& operator=(const PlanCache& other) = delete;
+
+    /**
+     * @param const PlanKey& key         - The key.
+     * @param const unsigned char* state - The state the plan should start from, key.num_disks towers.
+     * @return std::shared_ptr<const Plan> - The plan, or nullptr if the cache has no plan of that state.
+     */
+    std::shared_ptr<const Plan> find(const PlanKey& key, const unsigned char* state);
+
+    /**
+     * Puts a plan into the cache, and drops the least recently used plans of its stripe until it fits.
+     * If there is a plan with the same key already (put in first by another thread, or of another state
+     * with the same hash), that plan is kept.
+     */
+    void insert(const PlanKey& key, std::shared_ptr<const Plan> plan);
+
+    /**
+     * Finds the plan of a state, or computes it and puts it into the cache.
+     * A hit neither hashes the state nor allocates. Computing a plan takes O(num_disks + MAX_PLAN_MOVES) time,
+     * and only then are the towers and the hash checked, so a wrong hash is never cached.
+     * Throws std::invalid_argument if the plan has to be computed and a tower is not 0 ... 2,
+     * or the hash is not the hash of the state.
+     *
+     * @param const unsigned char* state - state[i] is the tower (0 ... 2) of disk i.
+     * @param size_t num_disks           - The number of disks.
+     * @param int target                 - The tower where all the disks should end up.
+     * @param uint64_t hash              - The Zobrist hash of the state, such as Solver::getHash().
+     * @return std::shared_ptr<const Plan> - The plan.
+     */
+    std::shared_ptr<const Plan> plan(const unsigned char* state, size_t num_disks, int target, uint64_t hash);
+
+    /**
+     * The same, for a caller which does not know the hash of the state.
+     */
+    std::shared_ptr<const Plan> plan(const vector<unsigned char>& state, int target);
+
+    /**
+     * @return PlanCacheStats - The hits and the misses of find(), the evictions, and the plans in the cache now.
+     */
+    PlanCacheStats stats() const;
+
+    /**
+     * @return size_t - The bytes which keeping the plan in the cache takes.
+     */
+    static size_t plan_bytes(const Plan& plan);
+
+  private:
+    struct KeyHash {
+	size_t operator()(const PlanKey& key) const { return size_t(key.hash ^ (key.num_disks << 2) ^ key.target); }
+    };
+
+    typedef std::list<std::pair<PlanKey, std::shared_ptr<const Plan>>> LruList;
+
+    struct Stripe {
+	mutable std::mutex mutex;
+	// The most recently used plan first.
+	LruList lru;
+	std::unordered_map<PlanKey, LruList::iterator, KeyHash> index;
+	// The sum of plan_bytes() of the plans in lru.
+	size_t bytes = 0;
+    };
+
+    Stripe& stripe_of(const PlanKey& key);
+
+    size_t stripe_capacity;
+    Stripe stripes[PLAN_CACHE_STRIPES];
+    std::atomic<uint64_t> hits;
+    std::atomic<uint64_t> misses;
+    std::atomic<uint64_t> evictions;
+};
+
+#endif /* PLAN_CACHE_H */
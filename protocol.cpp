@@ -0,0 +1,142 @@
+#include "protocol.h"
+
+#include <stdexcept>  // for std::invalid_argument
+
+
+void MessageWriter::put_u8(uint8_t value)
+{
+    buffer += char(value);
+}
+
+
+void MessageWriter::put_u32(uint32_t value)
+{
+    for (int i = 0; i < 4; ++i) {
+	buffer += char(value >> (8 * i));
+    }
+}
+
+
+void MessageWriter::put_u64(uint64_t value)
+{
+    for (int i = 0; i < 8; ++i) {
+	buffer += char(value >> (8 * i));
+    }
+}
+
+
+void MessageWriter::put_index(const MoveIndex& index)
+{
+    const vector<uint64_t>& words = index.get_words();
+    buffer += char(words.size());
+    buffer += char(words.size() >> 8);
+    for (uint64_t word : words) {
+	put_u64(word);
+    }
+}
+
+
+void MessageWriter::put_state(const vector<unsigned char>& state)
+{
+    buffer.append(state.begin(), state.end());
+}
+
+
+void MessageReader::need(size_t count) const
+{
+    if (size - offset < count) {
+	throw std::invalid_argument("message too short");
+    }
+}
+
+
+uint8_t MessageReader::get_u8()
+{
+    need(1);
+    return uint8_t(data[offset++]);
+}
+
+
+uint32_t MessageReader::get_u32()
+{
+    need(4);
+    uint32_t value = read_u32(data + offset);
+    offset += 4;
+    return value;
+}
+
+
+uint64_t MessageReader::get_u64()
+{
+    need(8);
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+	value = (value << 8) | uint8_t(data[offset + i]);
+    }
+    offset += 8;
+    return value;
+}
+
+
+MoveIndex MessageReader::get_index()
+{
+    need(2);
+    size_t count = uint8_t(data[offset]) | (size_t(uint8_t(data[offset + 1])) << 8);
+    offset += 2;
+    need(count * 8);
+
+    vector<uint64_t> words(count);
+    for (uint64_t& word : words) {
+	word = get_u64();
+    }
+    return MoveIndex::from_words(words);
+}
+
+
+vector<unsigned char> MessageReader::get_state(size_t num_disks)
+{
+    need(num_disks);
+    vector<unsigned char> state(data + offset, data + offset + num_disks);
+    offset += num_disks;
+    return state;
+}
+
+
+const unsigned char* MessageReader::get_state_bytes(size_t num_disks)
+{
+    need(num_disks);
+    const unsigned char* state = reinterpret_cast<const unsigned char*>(data + offset);
+    offset += num_disks;
+    return state;
+}
+
+
+void append_frame(string& out, uint32_t id, uint8_t code, const string& payload)
+{
+    MessageWriter header;
+    header.put_u32(uint32_t(FRAME_HEADER - 4 + payload.size()));
+    header.put_u32(id);
+    header.put_u8(code);
+    out += header.getBuffer();
+    out += payload;
+}
+
+
+size_t complete_frame(const char* data, size_t size)
+{
+    if (size < 4) {
+	return 0;
+    }
+    uint32_t length = read_u32(data);
+    if (length > MAX_FRAME_LENGTH || length < FRAME_HEADER - 4) {
+	throw std::invalid_argument("invalid frame length");
+    }
+    return size - 4 >= length ? length + 4 : 0;
+}
+
+
+uint32_t read_u32(const char* data)
+{
+    return uint32_t(uint8_t(data[0])) | (uint32_t(uint8_t(data[1])) << 8) |
+	   (uint32_t(uint8_t(data[2])) << 16) | (uint32_t(uint8_t(data[3])) << 24);
+}
@@ -0,0 +1,142 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include "move_index.h"
+
+#include <cstdint>   // for std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+using std::vector;
+
+/*
+ * The binary protocol of the query server (see class QueryServer).
+ *
+ * Every request and every response is a frame:
+ *     uint32 length  - The number of bytes after this field.
+ *     uint32 id      - Chosen by the client, copied into the response, so the client can match them.
+ *     uint8  code    - The operation (OP_...) in a request, the status (STATUS_...) in a response.
+ *     payload
+ * All the numbers are little-endian.
+ * A move index is written as a uint16 number of words, followed by that many uint64 words, the least significant first.
+ * A state is written as one byte per disk, the tower of disk 0 first.
+ * A client may send many requests without waiting for the responses (pipelining),
+ * the responses of one connection come back in the same order as the requests.
+ * The server stops reading the requests of a client while a few megabytes of its responses wait to be read.
+ *
+ * Requests and their responses:
+ *     OP_MOVE_AT   uint32 disks, index k              -> uint32 disk, uint8 from, uint8 to
+ *     OP_STATE_AT  uint32 disks, index k              -> state (disks bytes)
+ *     OP_DISTANCE  uint32 disks, state a, state b     -> index
+ *     OP_RANGE     uint32 disks, index first, uint32 count
+ *                                                     -> uint32 n, then n times: uint32 disk, uint8 from, uint8 to
+ *     OP_PLAN      uint32 disks, state, uint64 hash, uint8 target, uint32 count
+ *                                                     -> index distance, uint32 n, then n times: uint32 disk, uint8 from, uint8 to
+ *                  The fewest moves from the state to all the disks on the target tower, and the first n of them
+ *                  (n <= count, MAX_PLAN_MOVES). The hash is the Zobrist hash of the state (see zobrist.h), which the client
+ *                  keeps up to date as it moves. The plans are cached by it, so asking again about the same state
+ *                  is a hash lookup. A hash which does not match the state is a bad request.
+ *     OP_PLAN_STATS (empty)                            -> uint64 hits, uint64 misses, uint64 evictions, uint64 entries,
+ *                                                         uint64 bytes
+ *                  The counters of the plan cache, and the bytes its plans take.
+ * Any malformed request gets STATUS_BAD_REQUEST with an empty payload.
+ */
+
+#define OP_MOVE_AT  1
+#define OP_STATE_AT 2
+#define OP_DISTANCE 3
+#define OP_RANGE    4
+#define OP_PLAN     5
+#define OP_PLAN_STATS 6
+
+#define STATUS_OK          0
+#define STATUS_BAD_REQUEST 1
+
+// The size of the length field plus the id and the code.
+#define FRAME_HEADER 9
+// No frame may be longer than this.
+#define MAX_FRAME_LENGTH (1 << 24)
+
+/**
+ * Builds the payload of a message.
+ */
+class MessageWriter {
+  public:
+    void put_u8(uint8_t value);
+    void put_u32(uint32_t value);
+    void put_u64(uint64_t value);
+    void put_index(const MoveIndex& index);
+    void put_state(const vector<unsigned char>& state);
+
+    inline const string& getBuffer() const { return buffer; }
+    inline void clear() { buffer.clear(); }
+
+  private:
+    string buffer;
+};
+
+/**
+ * Reads the payload of a message.
+ * Throws std::invalid_argument if the payload is too short for what is being read.
+ */
+class MessageReader {
+  public:
+    MessageReader(const char* data, size_t size) : data{data}, size{size}, offset{0} {}
+
+    uint8_t get_u8();
+    uint32_t get_u32();
+    uint64_t get_u64();
+    MoveIndex get_index();
+    vector<unsigned char> get_state(size_t num_disks);
+
+    /**
+     * Reads a state without copying it.
+     *
+     * @return const unsigned char* - The num_disks towers, inside the payload.
+     */
+    const unsigned char* get_state_bytes(size_t num_disks);
+
+    /**
+     * @return bool - true if the whole payload has been read.
+     */
+    inline bool at_end() const { return offset == size; }
+
+  private:
+    // Throws std::invalid_argument unless there are at least count more bytes.
+    void need(size_t count) const;
+
+    const char* data;
+    size_t size;
+    size_t offset;
+};
+
+/**
+ * Appends a whole frame to out.
+ *
+ * @param string& out           - Where the frame goes, such as the output buffer of a connection.
+ * @param uint32_t id           - The id of the request.
+ * @param uint8_t code          - The operation or the status.
+ * @param const string& payload - The payload.
+ */
+void append_frame(string& out, uint32_t id, uint8_t code, const string& payload);
+
+/**
+ * Checks whether data starts with a whole frame.
+ * Throws std::invalid_argument if the frame claims to be longer than MAX_FRAME_LENGTH or shorter than its header.
+ *
+ * @return size_t - The size of that frame, or 0 if more bytes are needed.
+ */
+size_t complete_frame(const char* data, size_t size);
+
+/**
+ * Reads the little-endian uint32 at data.
+ */
+uint32_t read_u32(const char* data);
+
+#endif /* PROTOCOL_H */
@@ -0,0 +1,425 @@
+#include "server.h"
+#include "move_table.h"
+#include "state.h"
+
+#include <algorithm>  // for std::min
+#include <cerrno>     // for errno, EAGAIN, EINTR
+#include <csignal>    // for sigaction, SIGINT, SIGTERM, sig_atomic_t
+#include <cstring>    // for std::strerror, std::memset, std::strncpy
+#include <stdexcept>  // for std::invalid_argument, std::runtime_error
+
+#include <fcntl.h>       // for fcntl, O_NONBLOCK
+#include <sys/epoll.h>   // for epoll_create1, epoll_ctl, epoll_wait
+#include <sys/socket.h>  // for socket, bind, listen, accept4, recv, send
+#include <sys/un.h>      // for sockaddr_un
+#include <unistd.h>      // for close, unlink
+
+
+namespace {
+
+// The largest number of disks a query may ask about.
+const uint32_t MAX_QUERY_DISKS = 1 << 20;
+// The largest number of moves a single range request may ask for.
+const uint32_t MAX_RANGE_MOVES = 1 << 16;
+// No more than this many warm Solvers are kept.
+const size_t MAX_WARM_SOLVERS = 64;
+// The largest number of bytes the cached plans may take.
+const size_t PLAN_CACHE_CAPACITY = size_t(64) << 20;
+// No more requests of a connection are answered while this many bytes of its responses wait to be written.
+const size_t MAX_PENDING_OUTPUT = size_t(4) << 20;
+// The number of events handled per call to epoll_wait().
+const int MAX_EVENTS = 64;
+
+// Set by the signal handler to stop the event loop.
+volatile std::sig_atomic_t stop_requested = 0;
+
+void request_stop(int)
+{
+    stop_requested = 1;
+}
+
+// Throws std::runtime_error with the message of errno.
+void fail(const string& what)
+{
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+uint32_t get_num_disks(MessageReader& request)
+{
+    uint32_t num_disks = request.get_u32();
+    if (num_disks == 0 || num_disks > MAX_QUERY_DISKS) {
+	throw std::invalid_argument("invalid number of disks");
+    }
+    return num_disks;
+}
+
+void check_state(const vector<unsigned char>& state)
+{
+    for (unsigned char tower : state) {
+	if (tower > 2) {
+	    throw std::invalid_argument("invalid state");
+	}
+    }
+}
+
+void put_move(MessageWriter& response, const Move& move)
+{
+    response.put_u32(uint32_t(move.disk));
+    response.put_u8(uint8_t(move.from));
+    response.put_u8(uint8_t(move.to));
+}
+
+}  // namespace
+
+
+QueryServer::QueryServer(const string& socket_path)
+    : socket_path{socket_path}, listen_fd{-1}, epoll_fd{-1}, plans{PLAN_CACHE_CAPACITY}
+{
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+	throw std::runtime_error("socket path is too long: " + socket_path);
+    }
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+	fail("socket");
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+	close(listen_fd);
+	fail("bind " + socket_path);
+    }
+    if (listen(listen_fd, SOMAXCONN) < 0) {
+	close(listen_fd);
+	fail("listen");
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+	close(listen_fd);
+	fail("epoll_create1");
+    }
+    epoll_event event;
+    event.events  = EPOLLIN;
+    event.data.fd = listen_fd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event) < 0) {
+	close(epoll_fd);
+	close(listen_fd);
+	fail("epoll_ctl");
+    }
+}
+
+
+QueryServer::~QueryServer()
+{
+    for (auto& entry : connections) {
+	close(entry.first);
+    }
+    close(epoll_fd);
+    close(listen_fd);
+    unlink(socket_path.c_str());
+}
+
+
+void QueryServer::run()
+{
+    // No SA_RESTART, so that epoll_wait() returns with EINTR and the loop sees the request to stop.
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    epoll_event events[MAX_EVENTS];
+    while (!stop_requested) {
+	int count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
+	if (count < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    fail("epoll_wait");
+	}
+
+	for (int i = 0; i < count; ++i) {
+	    int fd = events[i].data.fd;
+	    if (fd == listen_fd) {
+		accept_connections();
+		continue;
+	    }
+
+	    auto it = connections.find(fd);
+	    if (it == connections.end()) {
+		continue;
+	    }
+	    bool keep = true;
+	    if (events[i].events & EPOLLERR) {
+		keep = false;
+	    }
+	    // After a hang up there may still be requests to read, and serve() finds the end of the stream.
+	    if (keep && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+		keep = serve(fd, it->second);
+	    }
+	    if (keep && (events[i].events & EPOLLOUT)) {
+		keep = answer_requests(fd, it->second);
+	    }
+	    if (!keep) {
+		close_connection(fd);
+	    }
+	}
+    }
+}
+
+
+void QueryServer::accept_connections()
+{
+    while (true) {
+	int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (fd < 0) {
+	    // EAGAIN: no more pending connections. Anything else: drop this one and wait for the next event.
+	    return;
+	}
+	epoll_event event;
+	event.events  = EPOLLIN;
+	event.data.fd = fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+	    close(fd);
+	    continue;
+	}
+	connections[fd];
+    }
+}
+
+
+bool QueryServer::serve(int fd, Connection& connection)
+{
+    char buffer[64 * 1024];
+    while (connection.pending() < MAX_PENDING_OUTPUT) {
+	ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+	if (count > 0) {
+	    connection.input.append(buffer, count);
+	} else if (count == 0) {
+	    // The client closed its side of the connection. The requests it sent before that are answered,
+	    // and the connection is closed once the responses are written.
+	    connection.closing = true;
+	    break;
+	} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+	    break;
+	} else if (errno != EINTR) {
+	    return false;
+	}
+    }
+
+    return answer_requests(fd, connection);
+}
+
+
+bool QueryServer::answer_requests(int fd, Connection& connection)
+{
+    MessageWriter response;
+    while (true) {
+	// Answer the complete requests which have arrived, as long as the client keeps up with reading the responses.
+	size_t offset = 0;
+	while (connection.pending() < MAX_PENDING_OUTPUT) {
+	    size_t size;
+	    try {
+		size = complete_frame(connection.input.data() + offset, connection.input.size() - offset);
+	    } catch (const std::invalid_argument&) {
+		// The stream can not be framed any more.
+		return false;
+	    }
+	    if (size == 0) {
+		break;
+	    }
+
+	    const char* frame = connection.input.data() + offset;
+	    uint32_t id = read_u32(frame + 4);
+	    uint8_t op  = uint8_t(frame[8]);
+	    MessageReader request(frame + FRAME_HEADER, size - FRAME_HEADER);
+	    response.clear();
+	    uint8_t status = STATUS_OK;
+	    try {
+		answer(op, request, response);
+		if (!request.at_end()) {
+		    throw std::invalid_argument("extra bytes in the request");
+		}
+	    } catch (const std::invalid_argument&) {
+		status = STATUS_BAD_REQUEST;
+		response.clear();
+	    }
+	    append_frame(connection.output, id, status, response.getBuffer());
+	    offset += size;
+	}
+	connection.input.erase(0, offset);
+
+	bool throttled = connection.pending() >= MAX_PENDING_OUTPUT;
+	if (!flush(fd, connection)) {
+	    return false;
+	}
+	// If answering stopped for the responses, and writing them made room, go on answering.
+	if (!throttled || connection.pending() >= MAX_PENDING_OUTPUT) {
+	    break;
+	}
+    }
+
+    if (connection.closing && connection.pending() == 0) {
+	return false;
+    }
+    // Only ask for EPOLLOUT while there is something left to write. Stop asking for EPOLLIN while the client
+    // is not reading its responses, and once it has closed its side, since the end of the stream stays readable.
+    bool reading = !connection.closing && connection.pending() < MAX_PENDING_OUTPUT;
+    uint32_t events = (reading ? uint32_t(EPOLLIN) : 0u) | (connection.pending() > 0 ? uint32_t(EPOLLOUT) : 0u);
+    if (events != connection.events) {
+	epoll_event event;
+	event.events  = events;
+	event.data.fd = fd;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event) < 0) {
+	    return false;
+	}
+	connection.events = events;
+    }
+    return true;
+}
+
+
+bool QueryServer::flush(int fd, Connection& connection)
+{
+    while (connection.written < connection.output.size()) {
+	ssize_t count = send(fd, connection.output.data() + connection.written,
+			     connection.output.size() - connection.written, MSG_NOSIGNAL);
+	if (count > 0) {
+	    connection.written += count;
+	} else if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	    break;
+	} else if (count < 0 && errno == EINTR) {
+	    continue;
+	} else {
+	    return false;
+	}
+    }
+    if (connection.written == connection.output.size()) {
+	connection.output.clear();
+	connection.written = 0;
+    } else if (connection.written >= MAX_PENDING_OUTPUT) {
+	// Drop what has been written, so the output does not keep growing in front of what is pending.
+	connection.output.erase(0, connection.written);
+	connection.written = 0;
+    }
+    return true;
+}
+
+
+void QueryServer::close_connection(int fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+
+void QueryServer::answer(uint8_t op, MessageReader& request, MessageWriter& response)
+{
+    switch (op) {
+      case OP_MOVE_AT: {
+	  uint32_t num_disks = get_num_disks(request);
+	  MoveIndex k = request.get_index();
+	  Solver& solver = solver_for(num_disks);
+	  if (k >= solver.total_moves()) {
+	      throw std::invalid_argument("move index out of range");
+	  }
+	  // Small games come straight out of the tables.
+	  const PackedMove* table = move_table(num_disks);
+	  put_move(response, table != nullptr ? unpack_move(table[k.to_u64()]) : solver.move_at(k));
+	  break;
+      }
+      case OP_STATE_AT: {
+	  uint32_t num_disks = get_num_disks(request);
+	  MoveIndex k = request.get_index();
+	  Solver& solver = solver_for(num_disks);
+	  if (k > solver.total_moves()) {
+	      throw std::invalid_argument("move index out of range");
+	  }
+	  solver.seek(k);
+	  response.put_state(solver.getTowers());
+	  break;
+      }
+      case OP_DISTANCE: {
+	  uint32_t num_disks = get_num_disks(request);
+	  vector<unsigned char> a = request.get_state(num_disks);
+	  vector<unsigned char> b = request.get_state(num_disks);
+	  check_state(a);
+	  check_state(b);
+	  response.put_index(distance(a, b));
+	  break;
+      }
+      case OP_RANGE: {
+	  uint32_t num_disks = get_num_disks(request);
+	  MoveIndex first = request.get_index();
+	  uint32_t count = request.get_u32();
+	  Solver& solver = solver_for(num_disks);
+	  if (first > solver.total_moves() || count > MAX_RANGE_MOVES) {
+	      throw std::invalid_argument("invalid range");
+	  }
+	  // A range which continues the previous one does not need to seek.
+	  if (solver.position() != first) {
+	      solver.seek(first);
+	  }
+	  MoveIndex left = solver.total_moves() - first;
+	  if (left.fits_u64() && left.to_u64() < count) {
+	      count = uint32_t(left.to_u64());
+	  }
+	  response.put_u32(count);
+	  for (uint32_t i = 0; i < count; ++i) {
+	      put_move(response, solver.next());
+	  }
+	  break;
+      }
+      case OP_PLAN: {
+	  uint32_t num_disks = get_num_disks(request);
+	  const unsigned char* state = request.get_state_bytes(num_disks);
+	  uint64_t hash = request.get_u64();
+	  uint8_t target = request.get_u8();
+	  uint32_t count = request.get_u32();
+	  if (target > 2) {
+	      throw std::invalid_argument("invalid tower");
+	  }
+	  // The state is looked up by the hash the client keeps, straight out of the request,
+	  // and it is only checked and hashed here when its plan has to be computed.
+	  std::shared_ptr<const Plan> plan = plans.plan(state, num_disks, target, hash);
+	  count = std::min<size_t>(count, plan->moves.size());
+	  response.put_index(plan->distance);
+	  response.put_u32(count);
+	  for (uint32_t i = 0; i < count; ++i) {
+	      put_move(response, plan->moves[i]);
+	  }
+	  break;
+      }
+      case OP_PLAN_STATS: {
+	  PlanCacheStats stats = plans.stats();
+	  response.put_u64(stats.hits);
+	  response.put_u64(stats.misses);
+	  response.put_u64(stats.evictions);
+	  response.put_u64(stats.entries);
+	  response.put_u64(stats.bytes);
+	  break;
+      }
+      default:
+	  throw std::invalid_argument("unknown operation");
+    }
+}
+
+
+Solver& QueryServer::solver_for(size_t num_disks)
+{
+    auto it = solvers.find(num_disks);
+    if (it != solvers.end()) {
+	return it->second;
+    }
+    if (solvers.size() >= MAX_WARM_SOLVERS) {
+	solvers.clear();
+    }
+    return solvers.emplace(num_disks, Solver(num_disks)).first->second;
+}
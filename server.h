@@ -0,0 +1,118 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "plan_cache.h"
+#include "protocol.h"
+#include "solver.h"
+
+#include <cstdlib>   // for std::size_t
+#include <map>       // for std::map
+#include <string>    // for std::string
+
+#include <sys/epoll.h>  // for EPOLLIN
+
+using std::map;
+using std::size_t;
+using std::string;
+
+/**
+ * A long-running daemon which answers queries about the solution over a Unix domain socket
+ * (see protocol.h for the requests and their binary format).
+ *
+ * The process starts once, and then it keeps its data warm between the requests:
+ * small games are answered straight from the move tables built at compile time,
+ * and a Solver is kept for each number of disks, so a range request which continues where
+ * the previous one stopped does not have to seek again.
+ * The plans from arbitrary states are kept in a PlanCache, so a planner which keeps asking about
+ * the same states gets them by their Zobrist hash instead of having them worked out again.
+ *
+ * All the connections are served by a single thread with an epoll event loop.
+ * Every complete request in the input buffer of a connection is answered at once (pipelining),
+ * and the responses are written out as the socket becomes writable.
+ */
+class QueryServer {
+  public:
+    /**
+     * Creates the socket and starts listening on it.
+     * A stale socket file at that path is removed first.
+     * Throws std::runtime_error if the socket can not be set up.
+     *
+     * @param const string& socket_path - The path of the socket file.
+     */
+    QueryServer(const string& socket_path);
+
+    // Closes all the connections and removes the socket file.
+    ~QueryServer();
+
+    // I forbid you to copy or assign a QueryServer, it owns the file descriptors.
+    QueryServer(const QueryServer& other) = delete;
+    QueryServer& operator=(const QueryServer& other) = delete;
+
+    /**
+     * Serves the requests until the process gets SIGINT or SIGTERM.
+     */
+    void run();
+
+  private:
+    // The buffers of one client.
+    struct Connection {
+	string input;
+	string output;
+	// How much of output has already been written to the socket.
+	size_t written = 0;
+	// The events the connection is registered for with epoll.
+	uint32_t events = EPOLLIN;
+	// true once the client has shut down its side: the connection is closed as soon as all the output is written.
+	bool closing = false;
+
+	// The bytes of output which have not been written yet.
+	inline size_t pending() const { return output.size() - written; }
+    };
+
+    void accept_connections();
+
+    // Reads everything available, unless the client is not reading its responses (see answer_requests()),
+    // and answers the complete requests.
+    // Returns false if the connection should be closed.
+    bool serve(int fd, Connection& connection);
+
+    // Answers the complete requests which have arrived, and writes the responses.
+    // It stops answering, and stops reading the connection, while more than MAX_PENDING_OUTPUT bytes of responses
+    // wait to be written, and goes on when the client has read them, so a client which pipelines requests
+    // and never reads can not make the server keep their responses.
+    // The requests which arrived before the client shut down its side are still answered.
+    // Returns false if the connection should be closed, which is also the case when the client has shut down its side
+    // and everything has been answered and written.
+    bool answer_requests(int fd, Connection& connection);
+
+    // Writes as much of the output as the socket takes. Returns false if the connection failed.
+    bool flush(int fd, Connection& connection);
+
+    void close_connection(int fd);
+
+    /**
+     * Answers one request.
+     * Throws std::invalid_argument if the request is malformed.
+     *
+     * @param uint8_t op              - The operation.
+     * @param MessageReader& request  - The payload of the request.
+     * @param MessageWriter& response - Gets the payload of the response.
+     */
+    void answer(uint8_t op, MessageReader& request, MessageWriter& response);
+
+    // The warm Solver for num_disks disks.
+    Solver& solver_for(size_t num_disks);
+
+    string socket_path;
+    int listen_fd;
+    int epoll_fd;
+
+    // The connections, by their file descriptors.
+    map<int, Connection> connections;
+    // The warm Solvers, by their numbers of disks.
+    map<size_t, Solver> solvers;
+    // The plans asked for with OP_PLAN.
+    PlanCache plans;
+};
+
+#endif /* SERVER_H */
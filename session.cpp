@@ -0,0 +1,326 @@
+#include "session.h"
+#include "telemetry.h"  // for trace_now_ns()
+
+#include <algorithm>  // for std::min, std::max
+#include <cerrno>     // for errno
+#include <cstring>    // for std::memcmp, std::strerror
+#include <fstream>    // for std::ifstream
+#include <iterator>   // for std::istreambuf_iterator
+#include <stdexcept>  // for std::runtime_error
+
+
+namespace {
+
+const char MAGIC[8] = {'H', 'A', 'N', 'O', 'I', 'T', 'R', '1'};
+
+uint64_t zigzag(int value)
+{
+    return value < 0 ? uint64_t(-int64_t(value)) * 2 - 1 : uint64_t(value) * 2;
+}
+
+int unzigzag(uint64_t value)
+{
+    return value & 1 ? -int((value + 1) / 2) : int(value / 2);
+}
+
+}  // namespace
+
+
+SessionWriter::SessionWriter(const string& path, size_t num_disks)
+    : out{std::fopen(path.c_str(), "wb")}, last_us{0}, started{false}
+{
+    if (out == nullptr) {
+	throw std::runtime_error("can not create " + path + ": " + std::strerror(errno));
+    }
+    std::fwrite(MAGIC, 1, sizeof(MAGIC), out);
+    varint(num_disks);
+}
+
+
+SessionWriter::~SessionWriter()
+{
+    std::fclose(out);
+}
+
+
+void SessionWriter::input(uint64_t now_us, const PlaybackInput& input)
+{
+    switch (input.kind) {
+      case PlaybackInput::PAUSE:
+	  event(SessionEvent::PAUSE, now_us);
+	  break;
+      case PlaybackInput::SPEED:
+	  event(SessionEvent::SPEED, now_us);
+	  varint(zigzag(input.value));
+	  break;
+      case PlaybackInput::SEEK:
+	  event(SessionEvent::SEEK, now_us);
+	  varint(zigzag(input.value));
+	  break;
+    }
+}
+
+
+void SessionWriter::frame(uint64_t now_us)
+{
+    event(SessionEvent::FRAME, now_us);
+}
+
+
+void SessionWriter::move(uint64_t now_us, const Move& move)
+{
+    event(SessionEvent::MOVE, now_us);
+    varint(move.disk);
+    std::fputc(move.from | (move.to << 2), out);
+}
+
+
+void SessionWriter::event(SessionEvent::Kind kind, uint64_t now_us)
+{
+    // The session starts at its first event.
+    std::fputc(kind, out);
+    varint(started ? now_us - last_us : 0);
+    last_us = now_us;
+    started = true;
+}
+
+
+void SessionWriter::varint(uint64_t value)
+{
+    while (value >= 0x80) {
+	std::fputc(int(value & 0x7f) | 0x80, out);
+	value >>= 7;
+    }
+    std::fputc(int(value), out);
+}
+
+
+SessionReader::SessionReader(const string& path) : offset{0}, num_disks{0}
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+	throw std::runtime_error("can not open " + path + ": " + std::strerror(errno));
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+	throw std::runtime_error(path + " is not a session trace");
+    }
+    offset = sizeof(MAGIC);
+    num_disks = varint();
+    if (num_disks == 0 || num_disks > MAX_SESSION_DISKS) {
+	throw std::runtime_error(path + " has an invalid number of disks");
+    }
+}
+
+
+bool SessionReader::next(SessionEvent& event)
+{
+    if (offset == data.size()) {
+	return false;
+    }
+    uint8_t kind = data[offset++];
+    if (kind > SessionEvent::MOVE) {
+	throw std::runtime_error("invalid event in the session trace");
+    }
+    event.kind = SessionEvent::Kind(kind);
+    event.delta_us = varint();
+    event.value = 0;
+    if (event.kind == SessionEvent::SPEED || event.kind == SessionEvent::SEEK) {
+	event.value = unzigzag(varint());
+    } else if (event.kind == SessionEvent::MOVE) {
+	event.move.disk = varint();
+	if (offset == data.size()) {
+	    throw std::runtime_error("the session trace ends in the middle of an event");
+	}
+	uint8_t towers = data[offset++];
+	event.move.from = towers & 0x03;
+	event.move.to   = (towers >> 2) & 0x03;
+    }
+    return true;
+}
+
+
+uint64_t SessionReader::varint()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+	if (offset == data.size()) {
+	    throw std::runtime_error("the session trace ends in the middle of an event");
+	}
+	uint8_t byte = data[offset++];
+	value |= uint64_t(byte & 0x7f) << shift;
+	if ((byte & 0x80) == 0) {
+	    return value;
+	}
+    }
+    throw std::runtime_error("invalid number in the session trace");
+}
+
+
+Session::Session(size_t num_disks)
+    : num_disks{num_disks}, game{std::make_unique<Hanoi>(num_disks)}, moves{game->stream()}, position{0},
+      current{0, 0, 0}, moving{false}, elapsed_ms{0}, paused{false}, speed{0}, finished{false}, scene_dirty{true}
+{
+}
+
+
+void Session::play(Drawer* draw, SessionWriter* writer)
+{
+    vector<Move> made;
+    // The first frame does not advance the game, just like the first frame of a replay.
+    uint64_t last_us = 0;
+    bool started = false;
+    while (!finished) {
+	draw->handleEvents();
+	uint64_t now_us = trace_now_ns() / 1000;
+	last_us = started ? last_us : now_us;
+	started = true;
+	for (const PlaybackInput& input : draw->take_inputs()) {
+	    if (writer != nullptr) {
+		writer->input(now_us, input);
+	    }
+	    apply(input);
+	}
+
+	// The frame is recorded before the moves it makes, the same order in which replay() checks them.
+	if (writer != nullptr) {
+	    writer->frame(now_us);
+	}
+	made.clear();
+	advance(now_us - last_us, made);
+	last_us = now_us;
+	for (const Move& move : made) {
+	    if (writer != nullptr) {
+		writer->move(now_us, move);
+	    }
+	}
+
+	draw_frame(draw);
+	draw->wait_for_next_frame();
+    }
+}
+
+
+vector<uint64_t> Session::replay(Drawer* draw, SessionReader& reader)
+{
+    if (reader.getNumDisks() != num_disks) {
+	throw std::runtime_error("the session trace is for a different number of disks");
+    }
+
+    vector<uint64_t> frame_ns;
+    vector<Move> made;
+    // The moves of the last frame which the trace has not confirmed yet.
+    size_t checked = 0;
+    uint64_t dt_us = 0;
+    SessionEvent event;
+    while (reader.next(event)) {
+	dt_us += event.delta_us;
+	if (event.kind == SessionEvent::MOVE) {
+	    if (checked == made.size() || !(made[checked] == event.move)) {
+		throw std::runtime_error("the replay diverged from the recording at move " + std::to_string(position));
+	    }
+	    ++checked;
+	    continue;
+	}
+	if (checked != made.size()) {
+	    throw std::runtime_error("the replay made a move which the recording did not");
+	}
+
+	switch (event.kind) {
+	  case SessionEvent::PAUSE:
+	      apply(PlaybackInput{PlaybackInput::PAUSE, 0});
+	      break;
+	  case SessionEvent::SPEED:
+	      apply(PlaybackInput{PlaybackInput::SPEED, event.value});
+	      break;
+	  case SessionEvent::SEEK:
+	      apply(PlaybackInput{PlaybackInput::SEEK, event.value});
+	      break;
+	  default: {
+	      made.clear();
+	      checked = 0;
+	      advance(dt_us, made);
+	      dt_us = 0;
+	      uint64_t start = trace_now_ns();
+	      draw_frame(draw);
+	      frame_ns.push_back(trace_now_ns() - start);
+	      break;
+	  }
+	}
+    }
+    if (checked != made.size()) {
+	throw std::runtime_error("the replay made a move which the recording did not");
+    }
+    return frame_ns;
+}
+
+
+void Session::apply(const PlaybackInput& input)
+{
+    switch (input.kind) {
+      case PlaybackInput::PAUSE:
+	  paused = !paused;
+	  break;
+      case PlaybackInput::SPEED:
+	  speed = std::max(MIN_SESSION_SPEED, std::min(MAX_SESSION_SPEED, speed + input.value));
+	  break;
+      case PlaybackInput::SEEK: {
+	  uint64_t total = (uint64_t(1) << num_disks) - 1;
+	  uint64_t step  = std::max<uint64_t>(1, total / SESSION_SEEK_FRACTION);
+	  seek(input.value < 0 ? (position > step ? position - step : 0) : std::min(total, position + step));
+	  break;
+      }
+    }
+}
+
+
+void Session::advance(uint64_t dt_us, vector<Move>& made)
+{
+    if (paused || finished) {
+	return;
+    }
+    // The time is scaled exactly by a power of two, so the replay comes out the same to the last bit.
+    elapsed_ms += dt_us / 1000.0 * (speed < 0 ? 1.0 / (1 << -speed) : double(1 << speed));
+    // A fast speed or a slow frame makes several moves in one frame.
+    while (elapsed_ms >= MOVE_MS) {
+	elapsed_ms -= MOVE_MS;
+	if (!moves.next()) {
+	    // The scene was drawn without the disk of the last move, which is now at rest on its tower.
+	    moving = false;
+	    finished = true;
+	    scene_dirty = true;
+	    break;
+	}
+	current = moves.value();
+	moving = true;
+	++position;
+	scene_dirty = true;
+	made.push_back(current);
+    }
+}
+
+
+void Session::seek(uint64_t target)
+{
+    // The old stream is dropped before the game it uses.
+    std::unique_ptr<Hanoi> fresh = std::make_unique<Hanoi>(num_disks);
+    moves = fresh->stream();
+    game = std::move(fresh);
+    for (position = 0; position < target && moves.next(); ++position) {
+    }
+    // The game pauses on the towers for one move's time before the next move.
+    moving = false;
+    elapsed_ms = 0;
+    finished = false;
+    scene_dirty = true;
+}
+
+
+void Session::draw_frame(Drawer* draw)
+{
+    if (scene_dirty) {
+	draw->set_scene(*game, moving ? int(current.disk) : EMPTY);
+	scene_dirty = false;
+    }
+    draw->draw_frame(*game, moving ? &current : nullptr, std::min(elapsed_ms, double(MOVE_MS)));
+}
@@ -0,0 +1,209 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include "drawer.h"
+#include "generator.h"
+#include "hanoi.h"
+#include "move.h"
+
+#include <cstdint>   // for std::uint64_t, std::uint8_t
+#include <cstdio>    // for FILE
+#include <cstdlib>   // for std::size_t
+#include <memory>    // for std::unique_ptr
+#include <string>    // for std::string
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::string;
+using std::uint64_t;
+using std::uint8_t;
+using std::vector;
+
+/*
+ * A session trace file records everything which decides what an interactive game shows, so it can be replayed exactly.
+ *
+ * The file starts with the magic "HANOITR1" and the number of disks (the initial configuration: all the disks on tower1).
+ * Then come the events, in the order they happened. Each event is one kind byte (SessionEvent::Kind),
+ * the time in microseconds since the previous event, and the payload of the kind:
+ *   FRAME - nothing. The frame advances the game by the time since the previous frame.
+ *   PAUSE - nothing.
+ *   SPEED - +1 or -1.
+ *   SEEK  - +1 or -1.
+ *   MOVE  - the disk, then one byte with the tower it goes from in bits 0-1 and the tower it goes to in bits 2-3.
+ *           The moves are not needed to replay the session, they are there to check that the replay makes the same moves.
+ * The times and the disks are unsigned LEB128 varints, the signed values are zigzag varints,
+ * so most events take 2 or 3 bytes: a whole game of 10 disks is about 100 KB.
+ */
+
+// The largest number of disks of an interactive game, and so of a session trace.
+#define MAX_SESSION_DISKS 10
+// The slowest and the fastest speed of a session: the moves are played 2^speed times as fast as normal.
+#define MIN_SESSION_SPEED -2
+#define MAX_SESSION_SPEED  4
+// A seek jumps this fraction of the whole game (but at least one move).
+#define SESSION_SEEK_FRACTION 16
+
+struct SessionEvent {
+    enum Kind : uint8_t {
+	FRAME,
+	PAUSE,
+	SPEED,
+	SEEK,
+	MOVE
+    };
+    Kind kind;
+    // The time since the previous event.
+    uint64_t delta_us;
+    // The value of a SPEED or SEEK event.
+    int value;
+    // The move of a MOVE event.
+    Move move;
+};
+
+/**
+ * Writes a session trace file. The events are buffered, and exit() flushes them,
+ * so the trace is complete even when the user quits in the middle of the game (see Drawer::handleEvents()).
+ */
+class SessionWriter {
+  public:
+    /**
+     * Creates the file and writes the header. Throws std::runtime_error if the file can not be created.
+     *
+     * @param const string& path - The trace file.
+     * @param size_t num_disks   - The number of disks of the game.
+     */
+    SessionWriter(const string& path, size_t num_disks);
+    ~SessionWriter();
+
+    // I forbid you to copy or assign a SessionWriter, it owns the file.
+    SessionWriter(const SessionWriter& other) = delete;
+    SessionWriter& operator=(const SessionWriter& other) = delete;
+
+    /**
+     * Each of these writes one event, which happened at the time now_us in microseconds (see trace_now_ns()).
+     */
+    void input(uint64_t now_us, const PlaybackInput& input);
+    void frame(uint64_t now_us);
+    void move(uint64_t now_us, const Move& move);
+
+  private:
+    void event(SessionEvent::Kind kind, uint64_t now_us);
+    void varint(uint64_t value);
+
+    FILE* out;
+    // The time of the previous event, if started.
+    uint64_t last_us;
+    bool started;
+};
+
+/**
+ * Reads a session trace file.
+ */
+class SessionReader {
+  public:
+    /**
+     * Reads the whole file and checks the header. Throws std::runtime_error if it is not a session trace.
+     *
+     * @param const string& path - The trace file.
+     */
+    SessionReader(const string& path);
+
+    /**
+     * @param SessionEvent& event - Set to the next event.
+     * @return bool - true if there was an event, false at the end of the file.
+     *                Throws std::runtime_error if the file ends in the middle of an event.
+     */
+    bool next(SessionEvent& event);
+
+    inline size_t getNumDisks() const { return num_disks; }
+
+  private:
+    uint64_t varint();
+
+    vector<uint8_t> data;
+    size_t offset;
+    size_t num_disks;
+};
+
+/**
+ * An interactive game, which the user can pause, speed up, slow down and seek through (see PlaybackInput).
+ *
+ * Everything that happens in a session is decided by the inputs and by the times between the frames,
+ * never by the wall clock directly, so a recorded session (see SessionWriter) can be replayed frame by frame:
+ * replay() feeds the recorded times and inputs back in, and the replay shows exactly the same frames, as fast
+ * as the renderer can draw them.
+ */
+class Session {
+  public:
+    /**
+     * @param size_t num_disks - The number of disks, 1 ... MAX_SESSION_DISKS, all of them start on tower1.
+     */
+    Session(size_t num_disks);
+
+    /**
+     * Plays the game until it is solved, drawing a frame at the refresh rate of the display.
+     *
+     * @param Drawer* draw           - A Drawer object which is responsible for displaying the game.
+     * @param SessionWriter* writer  - Records the session, or nullptr.
+     */
+    void play(Drawer* draw, SessionWriter* writer);
+
+    /**
+     * Replays a recorded session without waiting for the display, and times each frame.
+     * Throws std::runtime_error if the trace is for another number of disks,
+     * or if the replay makes a different move than the recording.
+     *
+     * @param Drawer* draw          - A Drawer object which draws the frames, usually into a software renderer.
+     * @param SessionReader& reader - The recorded session.
+     * @return vector<uint64_t> - How long drawing each frame took, in nanoseconds.
+     */
+    vector<uint64_t> replay(Drawer* draw, SessionReader& reader);
+
+    /**
+     * @return uint64_t - The number of moves made so far.
+     */
+    inline uint64_t getPosition() const { return position; }
+
+  private:
+    /**
+     * Applies a playback input.
+     */
+    void apply(const PlaybackInput& input);
+
+    /**
+     * Moves the animation on by the time since the previous frame, at the current speed,
+     * and pulls the next moves when the current one is over.
+     *
+     * @param uint64_t dt_us      - The time since the previous frame.
+     * @param vector<Move>& made  - The moves made are appended to it.
+     */
+    void advance(uint64_t dt_us, vector<Move>& made);
+
+    /**
+     * Starts the game over and makes moves without animating them, up to the move target.
+     */
+    void seek(uint64_t target);
+
+    /**
+     * Draws the current frame.
+     */
+    void draw_frame(Drawer* draw);
+
+    size_t num_disks;
+    // The game is declared before moves, so it is destroyed after the stream which uses it.
+    std::unique_ptr<Hanoi> game;
+    Generator<Move> moves;
+    uint64_t position;
+    // The move being animated, if moving.
+    Move current;
+    bool moving;
+    // The time since the current move started (or since the game started), in milliseconds.
+    double elapsed_ms;
+    bool paused;
+    int speed;
+    bool finished;
+    // true if the towers changed since the scene was drawn (see Drawer::set_scene()).
+    bool scene_dirty;
+};
+
+#endif /* SESSION_H */
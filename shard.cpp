@@ -0,0 +1,275 @@
+#include "shard.h"
+#include "move_range.h"
+
+#include <cerrno>     // for errno, ENOSPC, EINTR
+#include <chrono>     // for std::chrono::steady_clock, std::chrono::milliseconds
+#include <cstring>    // for std::strerror, std::memcmp, std::memcpy, strsignal
+#include <deque>      // for std::deque
+#include <iostream>   // for std::cerr, std::endl
+#include <map>        // for std::map
+#include <new>        // for placement new
+#include <stdexcept>  // for std::runtime_error, std::invalid_argument
+#include <thread>     // for std::this_thread::sleep_for
+#include <vector>     // for std::vector
+
+#include <fcntl.h>     // for open, posix_fallocate
+#include <signal.h>    // for kill, SIGKILL
+#include <sys/mman.h>  // for mmap, munmap, msync
+#include <sys/stat.h>  // for fstat
+#include <sys/wait.h>  // for waitpid, WIFEXITED, WEXITSTATUS, WIFSIGNALED, WTERMSIG
+#include <unistd.h>    // for fork, ftruncate, pread, close, sysconf, _exit
+
+using std::cerr;
+using std::endl;
+
+
+namespace {
+
+const char MAGIC[8] = {'H', 'A', 'N', 'O', 'I', 'S', 'H', '1'};
+
+// A worker publishes its progress every this many moves.
+const uint64_t PROGRESS_MOVES = 1 << 16;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+	      "the progress counters are shared between processes, so they must not hide a lock");
+
+size_t page_size()
+{
+    return size_t(sysconf(_SC_PAGESIZE));
+}
+
+void fail(const string& what)
+{
+    throw std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+/**
+ * Kill and reap the running workers, so none of them goes on writing into the mapping once run() has failed.
+ * Keeps errno, for the fail() which follows.
+ *
+ * @param const std::map<pid_t, size_t>& running - The running workers, by process id.
+ */
+void stop_workers(const std::map<pid_t, size_t>& running)
+{
+    int saved_errno = errno;
+    for (const auto& worker : running) {
+	kill(worker.first, SIGKILL);
+    }
+    for (const auto& worker : running) {
+	while (waitpid(worker.first, nullptr, 0) < 0 && errno == EINTR) {
+	}
+    }
+    errno = saved_errno;
+}
+
+}  // namespace
+
+
+ShardedGenerator::ShardedGenerator(const string& path, size_t num_disks, size_t num_shards)
+    : num_disks{num_disks}, num_shards{num_shards}, fd{-1}, map{nullptr}, map_size{0}, header_size{0}
+{
+    if (num_disks == 0 || num_disks > MAX_SHARD_DISKS) {
+	throw std::invalid_argument("the number of disks must be 1 ... " + std::to_string(MAX_SHARD_DISKS));
+    }
+    if (num_shards == 0 || num_shards > MAX_SHARDS || num_shards > total_moves()) {
+	throw std::invalid_argument("the number of shards must be 1 ... " + std::to_string(MAX_SHARDS) +
+				    " and at most the number of moves");
+    }
+
+    // The moves start on a page boundary.
+    size_t page = page_size();
+    header_size = (sizeof(ShardHeader) + num_shards * sizeof(ShardProgress) + page - 1) / page * page;
+    map_size = header_size + total_moves() * sizeof(ShardRecord);
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+	fail("open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) < 0) {
+	close(fd);
+	fail("stat " + path);
+    }
+
+    // An unfinished generation of the same game is resumed, anything else is replaced.
+    ShardHeader header;
+    bool resume = size_t(info.st_size) == map_size && pread(fd, &header, sizeof(header), 0) == sizeof(header) &&
+		  std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.num_disks == num_disks &&
+		  header.num_shards == num_shards && header.header_size == header_size;
+    if (!resume) {
+	// Reserve all the blocks up front, so running out of disk space shows up now rather than as a
+	// SIGBUS in a worker halfway through. A file system which can not preallocate just gets a sparse file.
+	if (ftruncate(fd, 0) < 0 || ftruncate(fd, map_size) < 0) {
+	    close(fd);
+	    fail("truncate " + path);
+	}
+	int error = posix_fallocate(fd, 0, map_size);
+	if (error == ENOSPC) {
+	    close(fd);
+	    errno = error;
+	    fail("preallocate " + path);
+	}
+    }
+
+    void* address = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+	close(fd);
+	fail("mmap " + path);
+    }
+    map = static_cast<char*>(address);
+
+    if (!resume) {
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.num_disks   = num_disks;
+	header.num_shards  = num_shards;
+	header.header_size = header_size;
+	std::memcpy(map, &header, sizeof(header));
+	// Split the moves as evenly as possible.
+	ShardProgress* shards = progress();
+	for (size_t i = 0; i < num_shards; ++i) {
+	    ShardProgress* shard = new (&shards[i]) ShardProgress;
+	    shard->first = total_moves() * i / num_shards;
+	    shard->last  = total_moves() * (i + 1) / num_shards;
+	    shard->done.store(0);
+	    shard->status.store(SHARD_PENDING);
+	    shard->padding = 0;
+	}
+    }
+}
+
+
+ShardedGenerator::~ShardedGenerator()
+{
+    msync(map, header_size, MS_SYNC);
+    munmap(map, map_size);
+    close(fd);
+}
+
+
+ShardProgress* ShardedGenerator::progress() const
+{
+    return reinterpret_cast<ShardProgress*>(map + sizeof(ShardHeader));
+}
+
+
+ShardRecord* ShardedGenerator::records() const
+{
+    return reinterpret_cast<ShardRecord*>(map + header_size);
+}
+
+
+uint64_t ShardedGenerator::moves_done() const
+{
+    uint64_t done = 0;
+    for (size_t i = 0; i < num_shards; ++i) {
+	done += progress()[i].done.load(std::memory_order_relaxed);
+    }
+    return done;
+}
+
+
+bool ShardedGenerator::run(unsigned num_workers)
+{
+    ShardProgress* shards = progress();
+    std::deque<size_t> queue;
+    for (size_t i = 0; i < num_shards; ++i) {
+	if (shards[i].status.load() != SHARD_DONE) {
+	    queue.push_back(i);
+	}
+    }
+
+    std::vector<unsigned> attempts(num_shards, 0);
+    // The running workers, by process id.
+    std::map<pid_t, size_t> running;
+    size_t failed = 0;
+    auto last_report = std::chrono::steady_clock::now();
+
+    while (!queue.empty() || !running.empty()) {
+	while (running.size() < num_workers && !queue.empty()) {
+	    size_t shard = queue.front();
+	    queue.pop_front();
+	    ++attempts[shard];
+	    pid_t pid = fork();
+	    if (pid < 0) {
+		stop_workers(running);
+		fail("fork");
+	    }
+	    if (pid == 0) {
+		work(shard);
+	    }
+	    running[pid] = shard;
+	}
+
+	int status;
+	pid_t pid = waitpid(-1, &status, WNOHANG);
+	if (pid > 0) {
+	    auto it = running.find(pid);
+	    if (it == running.end()) {
+		continue;
+	    }
+	    size_t shard = it->second;
+	    running.erase(it);
+	    if (WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS && shards[shard].status.load() == SHARD_DONE) {
+		continue;
+	    }
+
+	    // Only this shard is lost, and only the moves after its last published progress.
+	    cerr << "Shard " << shard << " failed ("
+		 << (WIFSIGNALED(status) ? strsignal(WTERMSIG(status)) : "exit " + std::to_string(WEXITSTATUS(status)))
+		 << ") at move " << shards[shard].first + shards[shard].done.load();
+	    if (attempts[shard] < MAX_SHARD_ATTEMPTS) {
+		cerr << ", retrying." << endl;
+		queue.push_back(shard);
+	    } else {
+		cerr << ", giving up after " << MAX_SHARD_ATTEMPTS << " attempts." << endl;
+		++failed;
+	    }
+	    continue;
+	}
+	if (pid < 0 && errno != EINTR && errno != ECHILD) {
+	    stop_workers(running);
+	    fail("waitpid");
+	}
+
+	auto now = std::chrono::steady_clock::now();
+	if (now - last_report >= std::chrono::seconds(1)) {
+	    last_report = now;
+	    cerr << "Progress " << moves_done() << " / " << total_moves() << " moves, "
+		 << running.size() << " workers running, " << queue.size() << " shards waiting" << endl;
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    msync(map, header_size, MS_SYNC);
+    return failed == 0;
+}
+
+
+void ShardedGenerator::work(size_t shard)
+{
+    ShardProgress& progress = this->progress()[shard];
+    ShardRecord* out = records();
+    uint64_t k = progress.first + progress.done.load(std::memory_order_acquire);
+
+    for (Move move : MoveRange::window(num_disks, k, progress.last)) {
+	out[k] = pack_record(move);
+	++k;
+	// The moves are in the shared mapping as soon as they are written, even if this process dies right after,
+	// so the progress can be published without flushing anything.
+	if ((k - progress.first) % PROGRESS_MOVES == 0) {
+	    progress.done.store(k - progress.first, std::memory_order_release);
+	}
+    }
+
+    // The shard is only marked done once its moves are on the disk.
+    size_t page = page_size();
+    size_t begin = (header_size + progress.first * sizeof(ShardRecord)) / page * page;
+    size_t end   = header_size + progress.last * sizeof(ShardRecord);
+    if (msync(map + begin, end - begin, MS_SYNC) < 0) {
+	_exit(EXIT_FAILURE);
+    }
+    progress.done.store(progress.last - progress.first, std::memory_order_release);
+    progress.status.store(SHARD_DONE, std::memory_order_release);
+    // _exit() rather than exit(): the worker must not run the atexit handlers or flush the stdio buffers of the driver.
+    _exit(EXIT_SUCCESS);
+}
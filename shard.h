@@ -0,0 +1,138 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include "move.h"
+
+#include <atomic>    // for std::atomic
+#include <cstdint>   // for std::uint64_t, std::uint32_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+
+/*
+ * The output file of a sharded generation.
+ *
+ * The file starts with a header of a whole number of pages: a ShardHeader followed by one ShardProgress per shard.
+ * After the header comes one 4-byte ShardRecord per move, move k at the offset header_size + 4 * k,
+ * so every shard writes its own region of the file and no two shards ever touch the same page of moves
+ * (except at the boundaries, which is harmless since they write different bytes).
+ * All the numbers are in the byte order of the machine, the file is meant to be read where it was written.
+ */
+
+// Each move is packed into 4 bytes:
+// bits 0-1 hold the tower it goes from, bits 2-3 hold the tower it goes to, bits 4-31 hold the disk.
+typedef uint32_t ShardRecord;
+
+inline constexpr ShardRecord pack_record(const Move& move)
+{
+    return ShardRecord(move.from | (move.to << 2) | (move.disk << 4));
+}
+
+inline constexpr Move unpack_record(ShardRecord record)
+{
+    return Move{size_t(record >> 4), int(record & 0x03), int((record >> 2) & 0x03)};
+}
+
+// The largest number of disks: 2^40 moves are 4 TB of records.
+#define MAX_SHARD_DISKS 40
+// The largest number of shards.
+#define MAX_SHARDS 4096
+// A shard which fails this many times in one run is given up on; running the generation again retries it.
+#define MAX_SHARD_ATTEMPTS 3
+
+struct ShardHeader {
+    char magic[8];
+    uint64_t num_disks;
+    uint64_t num_shards;
+    uint64_t header_size;
+};
+
+enum ShardStatus : uint32_t {
+    SHARD_PENDING,
+    SHARD_DONE
+};
+
+// The progress of one shard, [first, last) of the moves.
+// The progress lives in the header of the mapped file, so it is shared between the driver and the worker processes,
+// and it survives the driver too: running the same generation again picks up every unfinished shard where it stopped.
+struct ShardProgress {
+    uint64_t first;
+    uint64_t last;
+    // The number of moves from first on which are in the file.
+    std::atomic<uint64_t> done;
+    std::atomic<uint32_t> status;
+    uint32_t padding;
+};
+
+/**
+ * Generates the whole solution of a large game into a file, using several worker processes.
+ *
+ * The moves are split into shards of consecutive move indices. The driver (run()) forks a worker process
+ * for each shard, keeping at most num_workers of them running at a time. The file is preallocated and
+ * mapped into memory before the workers are forked, so each worker writes the moves of its shard straight
+ * into its region of the file and nothing is copied between the processes.
+ * Each worker computes its first move directly from its index (see MoveRange), so the shards are independent.
+ *
+ * A worker which crashes or is killed takes only its own shard down. The driver forks it again (up to
+ * MAX_SHARD_ATTEMPTS times), and the new worker resumes from the shard's progress counter instead of starting over.
+ */
+class ShardedGenerator {
+  public:
+    /**
+     * Opens the output file, or creates and preallocates it. If the file holds an unfinished generation
+     * of the same number of disks and shards, the shards which are done are kept.
+     * Throws std::runtime_error if the file can not be set up.
+     *
+     * @param const string& path - The output file.
+     * @param size_t num_disks   - The number of disks, 1 ... MAX_SHARD_DISKS.
+     * @param size_t num_shards  - The number of shards, 1 ... MAX_SHARDS.
+     */
+    ShardedGenerator(const string& path, size_t num_disks, size_t num_shards);
+    ~ShardedGenerator();
+
+    // I forbid you to copy or assign a ShardedGenerator, it owns the mapping of the file.
+    ShardedGenerator(const ShardedGenerator& other) = delete;
+    ShardedGenerator& operator=(const ShardedGenerator& other) = delete;
+
+    /**
+     * Runs the workers until every shard is done or has failed MAX_SHARD_ATTEMPTS times,
+     * printing the progress to the standard error about once a second.
+     *
+     * @param unsigned num_workers - The largest number of worker processes running at the same time, > 0.
+     * @return bool - true if every shard is done.
+     */
+    bool run(unsigned num_workers);
+
+    /**
+     * @return uint64_t - The number of moves in the file so far.
+     */
+    uint64_t moves_done() const;
+
+    /**
+     * @return uint64_t - The number of moves of the whole solution, 2^num_disks - 1.
+     */
+    inline uint64_t total_moves() const { return (uint64_t(1) << num_disks) - 1; }
+
+  private:
+    /**
+     * The body of a worker process: writes the rest of a shard, then leaves the process.
+     */
+    [[noreturn]] void work(size_t shard);
+
+    ShardProgress* progress() const;
+    ShardRecord* records() const;
+
+    size_t num_disks;
+    size_t num_shards;
+    int fd;
+    // The whole file, mapped shared.
+    char* map;
+    size_t map_size;
+    size_t header_size;
+};
+
+#endif /* SHARD_H */
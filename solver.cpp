@@ -0,0 +1,84 @@
+#include "solver.h"
+
+#include <utility>  // for std::swap
+
+
+Solver::Solver(size_t num_disks, int source, int target)
+    : num_disks{num_disks}, source{source}, target{target}, towers(num_disks, source),
+      hash{zobrist_hash(num_disks, source)}
+{
+    // total = 2^num_disks - 1, which is 11...11 with num_disks "bits".
+    total = MoveIndex::power_of_two(num_disks);
+    --total;
+
+    largest_step = (target - source + 3) % 3;
+}
+
+
+void Solver::seek(const MoveIndex& k)
+{
+    index = k;
+
+    // Walk the "bits" of k from the largest disk down to the smallest one.
+    // Each disk is moved by the solution exactly like the largest disk of a smaller puzzle:
+    // while its bit is 0 it still sits on the source tower of that smaller puzzle,
+    // which means that the disks above it are on their way from the source to the spare tower,
+    // and once its bit is 1 it sits on the target tower,
+    // which means that the disks above it are on their way from the spare tower to the target.
+    int from  = source;
+    int to    = target;
+    int spare = 3 - source - target;
+    for (size_t i = num_disks - 1; i != ~size_t(0); --i) {
+	if (!k.bit(i)) {
+	    towers[i] = from;
+	    std::swap(to, spare);
+	} else {
+	    towers[i] = to;
+	    std::swap(from, spare);
+	}
+    }
+    hash = zobrist_hash(towers);
+}
+
+
+Move Solver::next()
+{
+    // The counter goes from index to index + 1.
+    // The bit which gets flipped from 0 to 1 is the lowest 1 bit of index + 1,
+    // it is the name of the disk which moves.
+    ++index;
+    size_t disk = index.trailing_zeros();
+
+    int step = (num_disks - 1 - disk) % 2 == 0 ? largest_step : 3 - largest_step;
+    int from = towers[disk];
+    int to   = (from + step) % 3;
+    towers[disk] = to;
+
+    Move move{disk, from, to};
+    hash ^= zobrist_move_key(move);
+    return move;
+}
+
+
+Move Solver::move_at(const MoveIndex& k) const
+{
+    // The move number k moves the lowest 0 bit of k (the lowest 1 bit of k + 1).
+    // Before it the disk is on the source tower of its smaller puzzle, and it goes to the target tower.
+    // The towers of that smaller puzzle are found the same way as in seek().
+    size_t disk = 0;
+    while (k.bit(disk)) {
+	++disk;
+    }
+
+    int from  = source;
+    int to    = target;
+    int spare = 3 - source - target;
+    for (size_t i = num_disks - 1; i > disk; --i) {
+	if (!k.bit(i)) {
+	    std::swap(to, spare);
+	} else {
+	    std::swap(from, spare);
+	}
+    }
+    return Move{disk, from, to};
+}
@@ -0,0 +1,121 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "move.h"
+#include "move_index.h"
+#include "zobrist.h"
+
+#include <cstdlib>   // for std::size_t
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::vector;
+
+/**
+ * The headless engine: it solves the Tower of Hanoi without any Tower objects or any drawing.
+ *
+ * Unlike class Hanoi, which can only walk the solution from the start, the Solver can jump to any move,
+ * even for thousands of disks, where the solution has an astronomical number of moves.
+ * Only O(num_disks) memory is used: the tower of each disk, and the number of moves made so far.
+ *
+ * It uses the same binary counting as Hanoi::add_one():
+ * the move number k (counting from 0) moves the disk whose bit gets flipped from 0 to 1 when
+ * the counter goes from k to k + 1.
+ * The towers are numbered 0, 1, 2, and all the disks go from the source tower to the target tower.
+ */
+class Solver {
+  public:
+    /**
+     * Puts all the disks onto the source tower, with no moves made yet.
+     *
+     * @param size_t num_disks - The number of disks in the game.
+     * @param int source       - The tower where all the disks start, 0 ... 2.
+     * @param int target       - The tower where all the disks end up, 0 ... 2, != source.
+     */
+    Solver(size_t num_disks, int source = 0, int target = 2);
+
+    /**
+     * @return size_t - The number of disks in the game.
+     */
+    inline size_t getNumDisks() const { return num_disks; }
+
+    /**
+     * @return const MoveIndex& - The number of moves in the whole solution, 2^num_disks - 1.
+     */
+    inline const MoveIndex& total_moves() const { return total; }
+
+    /**
+     * @return const MoveIndex& - The number of moves made so far.
+     *                            This is also the index of the move which next() returns.
+     */
+    inline const MoveIndex& position() const { return index; }
+
+    /**
+     * @return bool - true if all the disks are on the target tower.
+     */
+    inline bool done() const { return index == total; }
+
+    /**
+     * @param size_t disk - The number of the disk.
+     * @return int - The tower where that disk is now.
+     */
+    inline int tower_of(size_t disk) const { return towers[disk]; }
+
+    /**
+     * @return const vector<unsigned char>& - The tower of every disk, towers[0] is the tower of disk 0.
+     */
+    inline const vector<unsigned char>& getTowers() const { return towers; }
+
+    /**
+     * @return uint64_t - The Zobrist hash of getTowers() (see zobrist.h), kept up to date with one XOR per move.
+     */
+    inline uint64_t getHash() const { return hash; }
+
+    /**
+     * Puts the disks where they are after the first k moves of the solution, in O(num_disks) time.
+     *
+     * @param const MoveIndex& k - The number of moves, 0 ... total_moves().
+     */
+    void seek(const MoveIndex& k);
+
+    /**
+     * Makes the next move and returns it, in amortized O(1) time.
+     * Must not be called when done() is true.
+     *
+     * @return Move - The move which was made.
+     */
+    Move next();
+
+    /**
+     * Finds the move number k without making it or any other move, in O(num_disks) time.
+     *
+     * @param const MoveIndex& k - The index of the move, 0 ... total_moves() - 1.
+     * @return Move - That move.
+     */
+    Move move_at(const MoveIndex& k) const;
+
+  private:
+    // The number of disks in the game.
+    size_t num_disks;
+    // The tower where all the disks start.
+    int source;
+    // The tower where all the disks end up.
+    int target;
+
+    // 2^num_disks - 1
+    MoveIndex total;
+    // The number of moves made so far.
+    MoveIndex index;
+
+    // towers[i] is the tower (0 ... 2) of disk i.
+    vector<unsigned char> towers;
+    // The Zobrist hash of towers.
+    uint64_t hash;
+    // Each disk always goes around the towers in the same direction.
+    // The largest disk makes a single step from source to target: 1 to the right (0 -> 1 -> 2 -> 0),
+    // or 2 to the right, which is the same as 1 to the left (0 -> 2 -> 1 -> 0).
+    // Every next smaller disk goes the other way around.
+    int largest_step;
+};
+
+#endif /* SOLVER_H */
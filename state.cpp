@@ -0,0 +1,58 @@
+#include "state.h"
+#include "solver.h"
+
+
+vector<unsigned char> state_at(size_t num_disks, const MoveIndex& k)
+{
+    Solver solver(num_disks);
+    solver.seek(k);
+    return solver.getTowers();
+}
+
+
+MoveIndex moves_to_tower(const vector<unsigned char>& state, size_t num_disks, int target)
+{
+    // Walk the disks from the largest one down, just like stream_moves_from().
+    // A disk which is not on the goal tower costs 2^disk moves (itself, plus the smaller disks following it),
+    // and the smaller disks first have to go to its spare tower.
+    MoveIndex moves;
+    int goal = target;
+    for (size_t i = num_disks - 1; i != ~size_t(0); --i) {
+	if (state[i] != goal) {
+	    moves.set_bit(i, true);
+	    goal = 3 - state[i] - goal;
+	}
+    }
+    return moves;
+}
+
+
+MoveIndex distance(const vector<unsigned char>& from, const vector<unsigned char>& to)
+{
+    // Find the largest disk which is not in the same place.
+    size_t disk = from.size() - 1;
+    while (disk != ~size_t(0) && from[disk] == to[disk]) {
+	--disk;
+    }
+    if (disk == ~size_t(0)) {
+	return MoveIndex(0);
+    }
+
+    int spare = 3 - from[disk] - to[disk];
+
+    // Once: gather the smaller disks on the spare tower, move the disk,
+    // and then spread the smaller disks out from the spare tower (the reverse of gathering them there).
+    MoveIndex once = moves_to_tower(from, disk, spare);
+    ++once;
+    once += moves_to_tower(to, disk, spare);
+
+    // Twice: gather the smaller disks on the disk's target tower, move the disk to the spare tower,
+    // move all the smaller disks over to its source tower (2^disk - 1 moves), move the disk to its target tower,
+    // and then spread the smaller disks out from its source tower.
+    MoveIndex twice = moves_to_tower(from, disk, to[disk]);
+    twice += MoveIndex::power_of_two(disk);
+    ++twice;
+    twice += moves_to_tower(to, disk, from[disk]);
+
+    return once < twice ? once : twice;
+}
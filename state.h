@@ -0,0 +1,50 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include "move_index.h"
+
+#include <cstdlib>   // for std::size_t
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::vector;
+
+/*
+ * Queries about arrangements (states) of the disks on three towers.
+ * A state is a vector<unsigned char> where state[i] is the tower (0 ... 2) of disk i.
+ * Since the smaller disks are always on top of the larger ones, this is enough to describe the whole game.
+ */
+
+/**
+ * @param size_t num_disks   - The number of disks in the game.
+ * @param const MoveIndex& k - The number of moves, 0 ... 2^num_disks - 1.
+ * @return vector<unsigned char> - The state of the standard game (tower 0 to tower 2) after the first k moves.
+ */
+vector<unsigned char> state_at(size_t num_disks, const MoveIndex& k);
+
+/**
+ * The fewest moves needed to gather the disks 0 ... num_disks - 1 of a state onto one tower.
+ * Each disk which is not where it has to be moves once, after all the smaller disks have gone out of its way,
+ * which costs it 2^disk moves, so the answer is just a bit pattern. O(num_disks) time.
+ *
+ * @param const vector<unsigned char>& state - The state. Only the first num_disks disks are looked at.
+ * @param size_t num_disks                   - The number of (smallest) disks to gather.
+ * @param int target                         - The tower to gather them on.
+ * @return MoveIndex - The number of moves.
+ */
+MoveIndex moves_to_tower(const vector<unsigned char>& state, size_t num_disks, int target);
+
+/**
+ * The fewest moves needed to get from one state to another, in O(number of disks) time.
+ * The disks larger than the largest disk d which differs never move.
+ * Disk d moves either once, straight to its place, or twice, by way of the third tower,
+ * and the smaller disks are gathered on a single tower before each move of disk d.
+ * The answer is the smaller of these two ways.
+ *
+ * @param const vector<unsigned char>& from - The state to start from.
+ * @param const vector<unsigned char>& to   - The state to end with, of the same size.
+ * @return MoveIndex - The number of moves.
+ */
+MoveIndex distance(const vector<unsigned char>& from, const vector<unsigned char>& to);
+
+#endif /* STATE_H */
@@ -0,0 +1,153 @@
+#include "telemetry.h"
+
+#include <algorithm>  // for std::sort
+#include <chrono>     // for std::chrono::steady_clock
+#include <cstdio>     // for FILE, std::fopen, std::fprintf, std::fclose, std::snprintf
+#include <iostream>   // for std::cerr
+#include <memory>     // for std::unique_ptr
+#include <vector>     // for std::vector
+
+
+namespace {
+
+const char* const EVENT_NAMES[NUM_TRACE_EVENTS] = {
+    "frame", "background", "handle_events", "present", "delay", "event_latency"
+};
+
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// The ring buffer is about 1.5 MB, so it lives in static storage rather than on a stack.
+TraceRing ring;
+
+std::atomic<uint32_t> next_thread{1};
+thread_local uint32_t thread_number = 0;
+
+const char* export_path = nullptr;
+
+// A small number for each thread, which is what the trace viewers expect as a thread id.
+uint32_t this_thread()
+{
+    if (thread_number == 0) {
+	thread_number = next_thread.fetch_add(1, std::memory_order_relaxed);
+    }
+    return thread_number;
+}
+
+void export_trace()
+{
+    if (!write_chrome_trace(export_path)) {
+	std::cerr << "Error: can not write the trace to " << export_path << std::endl;
+    }
+    std::cerr << trace_summary();
+}
+
+}  // namespace
+
+
+size_t TraceRing::snapshot(TraceRecord* out) const
+{
+    uint64_t end   = next.load(std::memory_order_acquire);
+    uint64_t begin = end > TRACE_CAPACITY ? end - TRACE_CAPACITY : 0;
+    for (uint64_t i = begin; i != end; ++i) {
+	out[i - begin] = records[i & (TRACE_CAPACITY - 1)];
+    }
+    return end - begin;
+}
+
+
+uint64_t trace_now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+void record_trace(TraceEvent event, uint64_t start_ns, uint64_t duration_ns)
+{
+    ring.push(TraceRecord{start_ns, duration_ns, this_thread(), uint8_t(event)});
+}
+
+
+bool write_chrome_trace(const string& path)
+{
+    std::unique_ptr<TraceRecord[]> records(new TraceRecord[TRACE_CAPACITY]);
+    size_t count = ring.snapshot(records.get());
+
+    FILE* out = std::fopen(path.c_str(), "w");
+    if (out == nullptr) {
+	return false;
+    }
+    // Complete events ("ph":"X"), with the times in microseconds.
+    std::fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (size_t i = 0; i < count; ++i) {
+	const TraceRecord& record = records[i];
+	std::fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"render\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+		     i == 0 ? "" : ",", EVENT_NAMES[record.event], record.start_ns / 1000.0, record.duration_ns / 1000.0,
+		     record.thread);
+    }
+    std::fprintf(out, "\n]}\n");
+    return std::fclose(out) == 0;
+}
+
+
+string trace_summary()
+{
+    std::unique_ptr<TraceRecord[]> records(new TraceRecord[TRACE_CAPACITY]);
+    size_t count = ring.snapshot(records.get());
+
+    std::vector<uint64_t> durations[NUM_TRACE_EVENTS];
+    for (size_t i = 0; i < count; ++i) {
+	durations[records[i].event].push_back(records[i].duration_ns);
+    }
+
+    string summary;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-14s %8s %12s %12s %12s %12s\n", "event", "count", "mean_us", "p50_us", "p99_us", "max_us");
+    summary += line;
+    for (int event = 0; event < NUM_TRACE_EVENTS; ++event) {
+	std::vector<uint64_t>& times = durations[event];
+	if (times.empty()) {
+	    continue;
+	}
+	std::sort(times.begin(), times.end());
+	double total = 0;
+	for (uint64_t time : times) {
+	    total += time;
+	}
+	auto percentile = [&](double p) { return times[size_t(p * (times.size() - 1))] / 1000.0; };
+	std::snprintf(line, sizeof(line), "%-14s %8zu %12.1f %12.1f %12.1f %12.1f\n", EVENT_NAMES[event], times.size(),
+		      total / times.size() / 1000.0, percentile(0.5), percentile(0.99), times.back() / 1000.0);
+	summary += line;
+
+	// Bucket k holds the times in [2^(k-1), 2^k) microseconds, bucket 0 the times under 1 microsecond.
+	size_t buckets[64] = {};
+	int last = 0;
+	for (uint64_t time : times) {
+	    int bucket = 0;
+	    for (uint64_t us = time / 1000; us != 0; us >>= 1) {
+		++bucket;
+	    }
+	    ++buckets[bucket];
+	    last = bucket > last ? bucket : last;
+	}
+	summary += "    histogram_us";
+	for (int bucket = 0; bucket <= last; ++bucket) {
+	    std::snprintf(line, sizeof(line), " <%llu:%zu", 1ULL << bucket, buckets[bucket]);
+	    summary += line;
+	}
+	summary += '\n';
+    }
+    if (ring.pushed() > count) {
+	std::snprintf(line, sizeof(line), "(only the latest %zu of %llu records)\n", count, (unsigned long long)ring.pushed());
+	summary += line;
+    }
+    return summary;
+}
+
+
+void export_trace_at_exit(const char* path)
+{
+    if (export_path == nullptr) {
+	std::atexit(export_trace);
+    }
+    export_path = path;
+}
@@ -0,0 +1,138 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>    // for std::atomic
+#include <cstdint>   // for std::uint64_t, std::uint32_t, std::uint8_t
+#include <cstdlib>   // for std::size_t
+#include <string>    // for std::string
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+using std::uint8_t;
+
+/*
+ * Timing telemetry for the renderer.
+ *
+ * Timers record how long the parts of a frame take into a ring buffer, which holds the latest TRACE_CAPACITY
+ * records. When the program exits, the buffer can be exported as a Chrome trace (a JSON file which can be
+ * opened offline in chrome://tracing or Perfetto), together with a histogram summary of every kind of record.
+ */
+
+// The kinds of records.
+enum TraceEvent {
+    // A whole Drawer::draw_frame() or Drawer::draw_dashboard() call.
+    TRACE_FRAME,
+    // Drawer::drawBackground().
+    TRACE_BACKGROUND,
+    // Drawer::handleEvents().
+    TRACE_HANDLE_EVENTS,
+    // One SDL_RenderPresent().
+    TRACE_PRESENT,
+    // The SDL_Delay() between two frames.
+    TRACE_DELAY,
+    // From the moment SDL timestamped an input event to the moment handleEvents() got it.
+    TRACE_EVENT_LATENCY,
+    NUM_TRACE_EVENTS
+};
+
+// The ring buffer holds this many records, a power of 2.
+#define TRACE_CAPACITY (1 << 16)
+
+// One record: something which started at start_ns and took duration_ns.
+struct TraceRecord {
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    uint32_t thread;
+    uint8_t event;
+};
+
+/**
+ * A fixed-size ring buffer of TraceRecords, which any number of threads may write to without locks.
+ *
+ * Each writer claims the next slot with a single atomic increment and fills it in. Once the buffer is full,
+ * the oldest records are overwritten. The records are read by snapshot() only after the writers are done,
+ * such as at exit, so the reader never sees a record which is half written.
+ */
+class TraceRing {
+  public:
+    TraceRing() : next{0} {}
+
+    TraceRing(const TraceRing& other) = delete;
+    TraceRing& operator=(const TraceRing& other) = delete;
+
+    inline void push(const TraceRecord& record)
+    {
+	uint64_t slot = next.fetch_add(1, std::memory_order_relaxed);
+	records[slot & (TRACE_CAPACITY - 1)] = record;
+    }
+
+    /**
+     * @param TraceRecord* out - Gets the records, oldest first. Must have room for TRACE_CAPACITY records.
+     * @return size_t - The number of records written to out.
+     */
+    size_t snapshot(TraceRecord* out) const;
+
+    /**
+     * @return uint64_t - The number of records pushed since the start, including those which were overwritten.
+     */
+    inline uint64_t pushed() const { return next.load(std::memory_order_relaxed); }
+
+  private:
+    std::atomic<uint64_t> next;
+    TraceRecord records[TRACE_CAPACITY];
+};
+
+/**
+ * @return uint64_t - The nanoseconds since the program started, on the steady clock.
+ */
+uint64_t trace_now_ns();
+
+/**
+ * Adds a record to the ring buffer of the program.
+ */
+void record_trace(TraceEvent event, uint64_t start_ns, uint64_t duration_ns);
+
+/**
+ * Times the rest of the enclosing block, and records it when it is destroyed.
+ */
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(TraceEvent event) : event{event}, start_ns{trace_now_ns()} {}
+    ~ScopedTimer() { record_trace(event, start_ns, trace_now_ns() - start_ns); }
+
+    ScopedTimer(const ScopedTimer& other) = delete;
+    ScopedTimer& operator=(const ScopedTimer& other) = delete;
+
+  private:
+    TraceEvent event;
+    uint64_t start_ns;
+};
+
+/**
+ * Writes the records in the ring buffer of the program as a Chrome trace.
+ *
+ * @param const string& path - The JSON file.
+ * @return bool - false if the file can not be written.
+ */
+bool write_chrome_trace(const string& path);
+
+/**
+ * Summarizes the records in the ring buffer of the program, one block per kind of record:
+ * the count, the mean, the median, the 99th percentile and the maximum,
+ * and a histogram with one bucket per power of 2 microseconds.
+ *
+ * @return string - The summary.
+ */
+string trace_summary();
+
+/**
+ * Makes the program write the Chrome trace to a file, and the summary to the standard error, when it exits,
+ * however it exits (Drawer::handleEvents() calls exit() when the user quits).
+ *
+ * @param const char* path - The JSON file. It must live until the program exits, such as an element of argv.
+ */
+void export_trace_at_exit(const char* path);
+
+#endif /* TELEMETRY_H */
@@ -1,4 +1,5 @@
 #include "tower.h"
+#include "perf_counters.h"  // for PROFILE_SCOPE
 
 Tower::~Tower()
 {
@@ -10,29 +11,47 @@ Tower::~Tower()
 
 void Tower::push(int n)
 {
+    push_disk(new Disk(n, nullptr, nullptr));
+}
+
+
+void Tower::pop()
+{
+    // delete the current top disk.
+    // If the Tower is empty, pop_disk() returns nullptr, and deleting nullptr does nothing.
+    delete pop_disk();
+}
+
+
+void Tower::push_disk(Disk* disk)
+{
+    PROFILE_SCOPE(profile_tower_push);
+
+    disk->prev = top_disk;
+    disk->next = nullptr;
     // If the Tower is empty.
-    // TODO: Do I need to add a bot_disk == nullptr condition?
     if (top_disk == nullptr) {
-	top_disk = new Disk(n, nullptr, nullptr);
-	bot_disk = top_disk;
+	bot_disk = disk;
     } else {
-        Disk* temp = top_disk;
-	top_disk = new Disk(n, temp, nullptr);
-	temp->next = top_disk;
+	top_disk->next = disk;
     }
+    top_disk = disk;
 
     ++size;
 }
 
 
-void Tower::pop()
+Disk* Tower::pop_disk()
 {
+    PROFILE_SCOPE(profile_tower_pop);
+
     // If the Tower is empty.
     // TODO: Do I need to add a bot_disk == nullptr condition?
     if (top_disk == nullptr) {
-	return;
+	return nullptr;
     }
 
+    Disk* disk = top_disk;
     Disk* temp = top_disk->prev;
     // If the current top disk is not at the very bottom of the tower,
     // If it is not the only disk in the tower.
@@ -40,9 +59,7 @@ void Tower::pop()
 	temp->next = nullptr;
     }
 
-    // delete the current top disk.
-    delete top_disk;
-    // Move the temp_disk pointer to point to the previous disk in the tower.
+    // Move the top_disk pointer to point to the previous disk in the tower.
     // if temp != nullptr, then top_disk points to the previous disk.
     // if temp == nullptr, then there are no more disks, so top_disk points to nullptr,
     //     which is good because it indicates that the tower is empty.
@@ -53,6 +70,9 @@ void Tower::pop()
     }
 
     --size;
+
+    disk->prev = nullptr;
+    return disk;
 }
 
 
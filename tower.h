@@ -84,6 +84,20 @@ struct Tower {
      */
     void pop();
 
+    /**
+     * Puts a Disk, which was taken off another Tower by pop_disk(), onto the Tower in O(1) time.
+     * The Disk is relinked, not copied, so moving a disk from one Tower to another does not allocate anything.
+     * The Tower takes ownership of the Disk.
+     */
+    void push_disk(Disk* disk);
+
+    /**
+     * Takes the top Disk off the Tower in O(1) time, without deleting it.
+     * The caller takes ownership of the Disk, and should give it to another Tower with push_disk().
+     * @return Disk* - The top Disk, or nullptr if the Tower is empty.
+     */
+    Disk* pop_disk();
+
     /**
      * @return size_t - The number of disks on the Tower.
      */
@@ -0,0 +1,109 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include "move.h"
+
+#include <array>     // for std::array
+#include <cstdint>   // for std::uint64_t
+#include <cstdlib>   // for std::size_t
+#include <vector>    // for std::vector
+
+using std::size_t;
+using std::uint64_t;
+using std::vector;
+
+/*
+ * Zobrist hashing of the states of the game.
+ *
+ * Every (disk, tower) pair has a random 64-bit key, and the hash of a state is the XOR of the keys of
+ * where each disk is. A move takes one disk off one tower and puts it on another, so it changes the hash by
+ * key(disk, from) ^ key(disk, to). Those are combined ahead of time into one key per (disk, from, to),
+ * so keeping the hash of a game up to date costs a single XOR per move (see Hanoi::getHash(), Solver::getHash()).
+ *
+ * The keys are the same in every run of the program, so the hashes can be stored and compared between runs.
+ * Two different states get the same hash with a probability of about 2^-64.
+ */
+
+// The number of disks which have their keys in the tables. Larger disks compute their keys on the fly.
+#define ZOBRIST_TABLE_DISKS 64
+
+/**
+ * SplitMix64, a tiny generator whose outputs are well spread even for consecutive inputs.
+ */
+inline constexpr uint64_t splitmix64(uint64_t x)
+{
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @return uint64_t - The key of the disk sitting on the tower (0 ... 2).
+ */
+inline constexpr uint64_t zobrist_key(size_t disk, int tower)
+{
+    return splitmix64(uint64_t(disk) * 3 + tower);
+}
+
+/**
+ * The combined keys of the moves, built at compile time: ZOBRIST_MOVE_KEYS[disk][from][to].
+ */
+inline constexpr std::array<std::array<std::array<uint64_t, 3>, 3>, ZOBRIST_TABLE_DISKS> ZOBRIST_MOVE_KEYS = [] {
+    std::array<std::array<std::array<uint64_t, 3>, 3>, ZOBRIST_TABLE_DISKS> keys{};
+    for (size_t disk = 0; disk < ZOBRIST_TABLE_DISKS; ++disk) {
+	for (int from = 0; from < 3; ++from) {
+	    for (int to = 0; to < 3; ++to) {
+		keys[disk][from][to] = zobrist_key(disk, from) ^ zobrist_key(disk, to);
+	    }
+	}
+    }
+    return keys;
+}();
+
+/**
+ * @param const Move& move - A move.
+ * @return uint64_t - What the move XORs into the hash of the state.
+ */
+inline uint64_t zobrist_move_key(const Move& move)
+{
+    return move.disk < ZOBRIST_TABLE_DISKS ? ZOBRIST_MOVE_KEYS[move.disk][move.from][move.to]
+					   : zobrist_key(move.disk, move.from) ^ zobrist_key(move.disk, move.to);
+}
+
+/**
+ * Hashes a whole state in O(number of disks) time.
+ *
+ * @param const unsigned char* state - state[i] is the tower (0 ... 2) of disk i.
+ * @param size_t num_disks           - The number of disks.
+ * @return uint64_t - The hash.
+ */
+inline uint64_t zobrist_hash(const unsigned char* state, size_t num_disks)
+{
+    uint64_t hash = 0;
+    for (size_t disk = 0; disk < num_disks; ++disk) {
+	hash ^= zobrist_key(disk, state[disk]);
+    }
+    return hash;
+}
+
+/**
+ * @param const vector<unsigned char>& state - state[i] is the tower (0 ... 2) of disk i.
+ * @return uint64_t - The hash of the state.
+ */
+inline uint64_t zobrist_hash(const vector<unsigned char>& state)
+{
+    return zobrist_hash(state.data(), state.size());
+}
+
+/**
+ * @param size_t num_disks - The number of disks.
+ * @param int tower        - The tower (0 ... 2).
+ * @return uint64_t - The hash of the state with all the disks on that tower.
+ */
+inline uint64_t zobrist_hash(size_t num_disks, int tower)
+{
+    return zobrist_hash(vector<unsigned char>(num_disks, tower));
+}
+
+#endif /* ZOBRIST_H */